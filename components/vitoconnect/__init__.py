@@ -1,18 +1,392 @@
+import logging
+
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import uart
-from esphome.const import CONF_ID, CONF_PROTOCOL, CONF_UPDATE_INTERVAL
+import esphome.final_validate as fv
+from esphome.components import sensor, uart
+from esphome.const import (
+    CONF_ADDRESS,
+    CONF_ID,
+    CONF_LENGTH,
+    CONF_OFFSET,
+    CONF_PROTOCOL,
+    CONF_TYPE,
+    CONF_UPDATE_INTERVAL,
+    CONF_VALUE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
+)
+
+_LOGGER = logging.getLogger(__name__)
 
 CODEOWNERS = ["@dannerph"]
 
 DEPENDENCIES = ["uart"]
 
+AUTO_LOAD = ["sensor"]
+
 MULTI_CONF = True
 
 vitoconnect_ns = cg.esphome_ns.namespace("vitoconnect")
 VitoConnect = vitoconnect_ns.class_("VitoConnect", uart.UARTDevice, cg.PollingComponent)
+Datapoint = vitoconnect_ns.class_("Datapoint")
+DatapointBlock = vitoconnect_ns.class_("DatapointBlock", Datapoint)
 
 CONF_VITOCONNECT_ID = "vitoconnect_id"
+CONF_DIVISOR = "divisor"
+CONF_BITMASK = "bitmask"
+CONF_BLOCKS = "blocks"
+CONF_BLOCK_ID = "block_id"
+CONF_RESTORE_VALUES = "restore_values"
+CONF_PERSIST_INTERVAL = "persist_interval"
+CONF_POLL = "poll"
+CONF_POLL_CONDITION = "poll_condition"
+CONF_DATAPOINT = "datapoint"
+CONF_ELSE_INTERVAL = "else_interval"
+CONF_ADAPTIVE_INTERVAL = "adaptive_interval"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_THRESHOLD = "threshold"
+CONF_STATISTICS = "statistics"
+CONF_TRACE_BUFFER = "trace_buffer"
+CONF_LOOP_BUDGET = "loop_budget"
+CONF_BURST_LIMIT = "burst_limit"
+CONF_LOG_STATISTICS = "log_statistics"
+CONF_CAPTURE = "capture"
+
+UNIT_MICROSECOND = "µs"
+
+DatapointType = vitoconnect_ns.enum("DatapointType")
+
+# type: (codec, length in bytes, None if taken from `length`)
+DATAPOINT_TYPES = {
+    "uint8": (DatapointType.DP_UINT8, 1),
+    "int8": (DatapointType.DP_INT8, 1),
+    "uint16": (DatapointType.DP_UINT16, 2),
+    "int16": (DatapointType.DP_INT16, 2),
+    "uint32": (DatapointType.DP_UINT32, 4),
+    "int32": (DatapointType.DP_INT32, 4),
+    "systime": (DatapointType.DP_SYSTIME, 8),
+    "cycletime": (DatapointType.DP_CYCLETIME, 8),
+    "raw": (DatapointType.DP_RAW, None),
+}
+NUMERIC_TYPES = ["uint8", "int8", "uint16", "int16", "uint32", "int32"]
+
+PollMode = vitoconnect_ns.enum("PollMode")
+POLL_MODES = {
+    "always": PollMode.POLL_ALWAYS,
+    "once": PollMode.POLL_ONCE,
+    "on_boot": PollMode.POLL_ON_BOOT,
+}
+
+
+def _guard_value(value):
+    """Value of the guard, true/false for binary sensors."""
+    if isinstance(value, bool):
+        return float(value)
+    return cv.float_(value)
+
+
+# Poll regularly only while another datapoint has a value
+POLL_CONDITION_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_DATAPOINT): cv.use_id(Datapoint),
+        cv.Required(CONF_VALUE): _guard_value,
+        cv.Optional(CONF_ELSE_INTERVAL): cv.positive_time_period_milliseconds,
+    }
+)
+
+
+def _validate_adaptive_interval(config):
+    if config[CONF_MIN_INTERVAL] > config[CONF_MAX_INTERVAL]:
+        raise cv.Invalid(f"{CONF_MIN_INTERVAL} must not exceed {CONF_MAX_INTERVAL}")
+    return config
+
+
+# Own poll interval of a datapoint, also shorter than the hub's; the hub
+# checks them every 100 ms then
+DATAPOINT_UPDATE_INTERVAL = cv.All(
+    cv.positive_time_period_milliseconds,
+    cv.Range(min=cv.TimePeriod(seconds=1)),
+)
+
+
+# Poll interval following the rate of change of the value
+ADAPTIVE_INTERVAL_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Required(CONF_MIN_INTERVAL): cv.positive_time_period_milliseconds,
+            cv.Required(CONF_MAX_INTERVAL): cv.positive_time_period_milliseconds,
+            cv.Required(CONF_THRESHOLD): cv.positive_float,
+        }
+    ),
+    _validate_adaptive_interval,
+)
+
+
+def datapoint_schema(types=None, type_required=False):
+    """Common options of all datapoint platforms."""
+    type_key = cv.Required(CONF_TYPE) if type_required else cv.Optional(CONF_TYPE)
+    return cv.Schema(
+        {
+            cv.GenerateID(CONF_VITOCONNECT_ID): cv.use_id(VitoConnect),
+            cv.Exclusive(CONF_ADDRESS, "location"): cv.uint16_t,
+            cv.Exclusive(CONF_BLOCK_ID, "location"): cv.use_id(DatapointBlock),
+            cv.Optional(CONF_OFFSET): cv.uint8_t,
+            cv.Optional(CONF_LENGTH): cv.uint8_t,
+            cv.Optional(CONF_POLL): cv.enum(POLL_MODES, lower=True),
+            cv.Optional(CONF_POLL_CONDITION): POLL_CONDITION_SCHEMA,
+            cv.Optional(CONF_UPDATE_INTERVAL): DATAPOINT_UPDATE_INTERVAL,
+            cv.Optional(CONF_ADAPTIVE_INTERVAL): ADAPTIVE_INTERVAL_SCHEMA,
+            type_key: cv.one_of(*(types or NUMERIC_TYPES), lower=True),
+        }
+    )
+
+
+def validate_datapoint(default_length=None, writable=False, numeric=False):
+    """Check that the length is known and matches the type.
+
+    Writable datapoints are encoded by their codec, so they need a numeric
+    type, given or derived from the length like in Datapoint::setLength().
+    So do (numeric) ones, eg. sensors, which would publish NaN otherwise.
+    """
+
+    def validator(config):
+        if CONF_BLOCK_ID in config:
+            for key in (
+                CONF_POLL,
+                CONF_POLL_CONDITION,
+                CONF_UPDATE_INTERVAL,
+                CONF_ADAPTIVE_INTERVAL,
+            ):
+                if key in config:
+                    raise cv.Invalid(f"{key} is set by the block, not its datapoints")
+            config.setdefault(CONF_OFFSET, 0)
+        elif CONF_OFFSET in config:
+            raise cv.Invalid(f"{CONF_OFFSET} is only valid together with {CONF_BLOCK_ID}")
+        elif CONF_ADDRESS not in config:
+            raise cv.Invalid(f"Either {CONF_ADDRESS} or {CONF_BLOCK_ID} is required")
+
+        length = config.get(CONF_LENGTH)
+        if CONF_TYPE in config:
+            type_length = DATAPOINT_TYPES[config[CONF_TYPE]][1]
+            if type_length is None:
+                if length is None:
+                    raise cv.Invalid(f"Type {config[CONF_TYPE]} requires a length")
+            elif length is not None and length != type_length:
+                raise cv.Invalid(
+                    f"Type {config[CONF_TYPE]} has a length of {type_length}, not {length}"
+                )
+            else:
+                config[CONF_LENGTH] = type_length
+        elif length is None:
+            if default_length is None:
+                raise cv.Invalid(f"Either {CONF_TYPE} or {CONF_LENGTH} is required")
+            config[CONF_LENGTH] = default_length
+
+        numeric = config.get(CONF_TYPE, NUMERIC_TYPES[0]) in NUMERIC_TYPES
+        if CONF_ADAPTIVE_INTERVAL in config and not numeric:
+            raise cv.Invalid(f"{CONF_ADAPTIVE_INTERVAL} needs a numeric {CONF_TYPE}")
+        if CONF_ADAPTIVE_INTERVAL in config and CONF_UPDATE_INTERVAL in config:
+            raise cv.Invalid(
+                f"{CONF_UPDATE_INTERVAL} and {CONF_ADAPTIVE_INTERVAL} are exclusive"
+            )
+        if (writable or numeric) and CONF_TYPE not in config and config[CONF_LENGTH] not in (1, 2, 4):
+            purpose = "to be written" if writable else "for a numeric value"
+            raise cv.Invalid(
+                f"A {CONF_LENGTH} of {config[CONF_LENGTH]} needs a numeric {CONF_TYPE} {purpose}, "
+                f"which have 1, 2 or 4 bytes"
+            )
+        return config
+
+    return validator
+
+
+async def register_datapoint(var, config):
+    """Add datapoint configuration and register it at the hub (VitoConnect).
+
+    Datapoints inside a block are not registered themselves, they are decoded
+    from the block's data.
+    """
+    if CONF_ADDRESS in config:
+        cg.add(var.setAddress(config[CONF_ADDRESS]))
+    cg.add(var.setLength(config[CONF_LENGTH]))
+    if CONF_TYPE in config:
+        cg.add(var.setType(DATAPOINT_TYPES[config[CONF_TYPE]][0]))
+    if CONF_DIVISOR in config:
+        cg.add(var.setDivisor(config[CONF_DIVISOR]))
+    if CONF_BITMASK in config:
+        cg.add(var.setBitmask(config[CONF_BITMASK]))
+    if CONF_POLL in config:
+        cg.add(var.setPollMode(config[CONF_POLL]))
+    if CONF_UPDATE_INTERVAL in config:
+        cg.add(var.setUpdateInterval(config[CONF_UPDATE_INTERVAL]))
+    await set_poll_condition(var, config)
+    if CONF_ADAPTIVE_INTERVAL in config:
+        adaptive = config[CONF_ADAPTIVE_INTERVAL]
+        cg.add(
+            var.setAdaptiveInterval(
+                adaptive[CONF_MIN_INTERVAL],
+                adaptive[CONF_MAX_INTERVAL],
+                adaptive[CONF_THRESHOLD],
+            )
+        )
+
+    hub = await cg.get_variable(config[CONF_VITOCONNECT_ID])
+    if CONF_BLOCK_ID in config:
+        block = await cg.get_variable(config[CONF_BLOCK_ID])
+        cg.add(block.addChild(var, config[CONF_OFFSET]))
+    else:
+        cg.add(hub.register_datapoint(var))
+    return hub
+
+
+async def set_poll_condition(var, config):
+    """Poll the datapoint (or block) only while its guard has a value."""
+    if CONF_POLL_CONDITION not in config:
+        return
+    condition = config[CONF_POLL_CONDITION]
+    guard = await cg.get_variable(condition[CONF_DATAPOINT])
+    cg.add(
+        var.setPollCondition(
+            guard, condition[CONF_VALUE], condition.get(CONF_ELSE_INTERVAL, 0)
+        )
+    )
+
+
+DATAPOINT_PLATFORMS = [
+    "sensor",
+    "binary_sensor",
+    "text_sensor",
+    "number",
+    "select",
+    "switch",
+]
+
+
+def count_bus_reads(ranges):
+    """Number of reads after merging identical and overlapping ranges.
+
+    Mirrors VitoConnect::_buildReadGroups().
+    """
+    reads = 0
+    group_start = group_end = None
+    for start, end in sorted(ranges):
+        if group_end is not None and start < group_end:
+            if max(end, group_end) - group_start <= 0xFF:
+                group_end = max(end, group_end)
+                continue
+        reads += 1
+        group_start, group_end = start, end
+    return reads
+
+
+def _validate_block_children(blocks, conf):
+    """A block's datapoints have to lie within the block."""
+    block = blocks.get(conf[CONF_BLOCK_ID].id)
+    if block is None:
+        return
+    end = conf[CONF_OFFSET] + conf[CONF_LENGTH]
+    if end > block[CONF_LENGTH]:
+        raise cv.Invalid(
+            f"{CONF_OFFSET} {conf[CONF_OFFSET]} and {CONF_LENGTH} {conf[CONF_LENGTH]} exceed "
+            f"block {conf[CONF_BLOCK_ID].id} with a {CONF_LENGTH} of {block[CONF_LENGTH]}"
+        )
+
+
+def _final_validate(config):
+    full_config = fv.full_config.get()
+    hub_id = config[CONF_ID].id
+    confs = list(config.get(CONF_BLOCKS, []))
+    blocks = {conf[CONF_ID].id: conf for conf in confs}
+    for domain in DATAPOINT_PLATFORMS:
+        for conf in full_config.get(domain, []):
+            if conf.get("platform") != "vitoconnect":
+                continue
+            if CONF_BLOCK_ID in conf:
+                _validate_block_children(blocks, conf)
+                continue
+            if CONF_ADDRESS not in conf:
+                continue
+            if conf[CONF_VITOCONNECT_ID].id == hub_id:
+                confs.append(conf)
+    if config[CONF_PROTOCOL] == "GWG":
+        # GWG addresses a single byte, the function is taken from the MSB
+        for conf in confs:
+            if (conf[CONF_ADDRESS] & 0xFF) + conf[CONF_LENGTH] > 0x100:
+                raise cv.Invalid(
+                    f"Address 0x{conf[CONF_ADDRESS]:04X} with a {CONF_LENGTH} of "
+                    f"{conf[CONF_LENGTH]} exceeds the 1 byte address range of GWG"
+                )
+    # read-once datapoints are not part of the regular updates
+    ranges = [
+        (conf[CONF_ADDRESS], conf[CONF_ADDRESS] + conf[CONF_LENGTH])
+        for conf in confs
+        if conf.get(CONF_POLL, "always") == "always"
+    ]
+    _LOGGER.info(
+        "%s: %d datapoints need %d bus reads per update, %d are read once",
+        hub_id,
+        len(confs),
+        count_bus_reads(ranges),
+        len(confs) - len(ranges),
+    )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+Statistic = vitoconnect_ns.enum("Statistic")
+
+
+def _counter(unit=None):
+    return sensor.sensor_schema(
+        unit_of_measurement=unit,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+def _gauge(unit=None, accuracy_decimals=0):
+    return sensor.sensor_schema(
+        unit_of_measurement=unit,
+        accuracy_decimals=accuracy_decimals,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+# statistic: (enum, sensor schema)
+STATISTICS = {
+    "transactions": (Statistic.STAT_TRANSACTIONS, _counter()),
+    "errors": (Statistic.STAT_ERRORS, _counter()),
+    "timeout_errors": (Statistic.STAT_TIMEOUT_ERRORS, _counter()),
+    "length_errors": (Statistic.STAT_LENGTH_ERRORS, _counter()),
+    "nack_errors": (Statistic.STAT_NACK_ERRORS, _counter()),
+    "crc_errors": (Statistic.STAT_CRC_ERRORS, _counter()),
+    "device_errors": (Statistic.STAT_DEVICE_ERRORS, _counter()),
+    "tx_bytes": (Statistic.STAT_TX_BYTES, _counter(UNIT_BYTES)),
+    "rx_bytes": (Statistic.STAT_RX_BYTES, _counter(UNIT_BYTES)),
+    "rtt_p50": (Statistic.STAT_RTT_P50, _gauge(UNIT_MILLISECOND)),
+    "rtt_p95": (Statistic.STAT_RTT_P95, _gauge(UNIT_MILLISECOND)),
+    "rtt_max": (Statistic.STAT_RTT_MAX, _gauge(UNIT_MILLISECOND)),
+    "queue_high_water": (Statistic.STAT_QUEUE_HIGH_WATER, _gauge()),
+    "bus_utilization": (Statistic.STAT_BUS_UTILIZATION, _gauge(UNIT_PERCENT, 1)),
+    "sweep_duration": (Statistic.STAT_SWEEP_DURATION, _gauge(UNIT_MILLISECOND)),
+    "loop_time_max": (Statistic.STAT_LOOP_TIME_MAX, _gauge(UNIT_MICROSECOND)),
+    "loop_time_avg": (Statistic.STAT_LOOP_TIME_AVG, _gauge(UNIT_MICROSECOND)),
+    "publish_time_max": (Statistic.STAT_PUBLISH_TIME_MAX, _gauge(UNIT_MICROSECOND)),
+    "publish_time_avg": (Statistic.STAT_PUBLISH_TIME_AVG, _gauge(UNIT_MICROSECOND)),
+    "deferred_decodes": (Statistic.STAT_DEFERRED_DECODES, _counter()),
+    "recoveries": (Statistic.STAT_RECOVERIES, _counter()),
+    "recovery_time_max": (Statistic.STAT_RECOVERY_TIME_MAX, _gauge(UNIT_MILLISECOND)),
+    "discarded_answers": (Statistic.STAT_DISCARDED_ANSWERS, _counter()),
+}
 
 OPTOLINK_PROTOCOL = {
     "P300": "P300",
@@ -20,15 +394,49 @@ OPTOLINK_PROTOCOL = {
     "GWG": "GWG",
 }
 
-CONFIG_SCHEMA = cv.Schema(
-    {
-        cv.GenerateID(): cv.declare_id(VitoConnect),
-        cv.Required(CONF_PROTOCOL): cv.enum(OPTOLINK_PROTOCOL, upper=True, space="_"),
-        cv.Optional(
-            CONF_UPDATE_INTERVAL, default="60s"
-        ): cv.positive_time_period_milliseconds,
-    }
-).extend(uart.UART_DEVICE_SCHEMA)
+
+def _validate_burst_limit(config):
+    if CONF_BURST_LIMIT in config and config[CONF_PROTOCOL] != "GWG":
+        raise cv.Invalid(f"{CONF_BURST_LIMIT} is only supported by the GWG protocol")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(VitoConnect),
+            cv.Required(CONF_PROTOCOL): cv.enum(OPTOLINK_PROTOCOL, upper=True, space="_"),
+            cv.Optional(
+                CONF_UPDATE_INTERVAL, default="60s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_RESTORE_VALUES, default=False): cv.boolean,
+            cv.Optional(
+                CONF_PERSIST_INTERVAL, default="15min"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_BURST_LIMIT): cv.uint8_t,
+            cv.Optional(CONF_LOOP_BUDGET): cv.positive_time_period_microseconds,
+            cv.Optional(CONF_TRACE_BUFFER, default=0): cv.int_range(min=0, max=1000),
+            cv.Optional(CONF_CAPTURE, default=False): cv.boolean,
+            cv.Optional(CONF_LOG_STATISTICS, default=False): cv.boolean,
+            cv.Optional(CONF_STATISTICS): cv.Schema(
+                {cv.Optional(key): schema for key, (_, schema) in STATISTICS.items()}
+            ),
+            cv.Optional(CONF_BLOCKS): cv.ensure_list(
+                cv.Schema(
+                    {
+                        cv.Required(CONF_ID): cv.declare_id(DatapointBlock),
+                        cv.Required(CONF_ADDRESS): cv.uint16_t,
+                        cv.Required(CONF_LENGTH): cv.int_range(min=1, max=255),
+                        cv.Optional(CONF_POLL): cv.enum(POLL_MODES, lower=True),
+                        cv.Optional(CONF_POLL_CONDITION): POLL_CONDITION_SCHEMA,
+                        cv.Optional(CONF_UPDATE_INTERVAL): DATAPOINT_UPDATE_INTERVAL,
+                    }
+                )
+            ),
+        }
+    ).extend(uart.UART_DEVICE_SCHEMA),
+    _validate_burst_limit,
+)
 
 
 async def to_code(config):
@@ -37,3 +445,29 @@ async def to_code(config):
     await uart.register_uart_device(var, config)
     cg.add(var.set_protocol(config[CONF_PROTOCOL]))
     cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
+    cg.add(var.set_restore_values(config[CONF_RESTORE_VALUES]))
+    cg.add(var.set_persist_interval(config[CONF_PERSIST_INTERVAL]))
+    cg.add(var.set_trace_buffer(config[CONF_TRACE_BUFFER]))
+    cg.add(var.set_log_statistics(config[CONF_LOG_STATISTICS]))
+    cg.add(var.set_capture(config[CONF_CAPTURE]))
+    if CONF_BURST_LIMIT in config:
+        cg.add(var.set_burst_limit(config[CONF_BURST_LIMIT]))
+    if CONF_LOOP_BUDGET in config:
+        cg.add(var.set_loop_budget(config[CONF_LOOP_BUDGET]))
+
+    # Bus statistics, published once per update
+    for key, conf in config.get(CONF_STATISTICS, {}).items():
+        sens = await sensor.new_sensor(conf)
+        cg.add(var.set_statistic_sensor(STATISTICS[key][0], sens))
+
+    # Blocks are read at once and decoded into their child datapoints
+    for conf in config.get(CONF_BLOCKS, []):
+        block = cg.new_Pvariable(conf[CONF_ID])
+        cg.add(block.setAddress(conf[CONF_ADDRESS]))
+        cg.add(block.setLength(conf[CONF_LENGTH]))
+        if CONF_POLL in conf:
+            cg.add(block.setPollMode(conf[CONF_POLL]))
+        if CONF_UPDATE_INTERVAL in conf:
+            cg.add(block.setUpdateInterval(conf[CONF_UPDATE_INTERVAL]))
+        await set_poll_condition(block, conf)
+        cg.add(var.register_datapoint(block))
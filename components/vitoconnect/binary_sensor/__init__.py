@@ -1,31 +1,36 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import binary_sensor
-from esphome.const import CONF_ADDRESS
 
-from .. import CONF_VITOCONNECT_ID, VitoConnect, vitoconnect_ns
+from .. import (
+    CONF_BITMASK,
+    Datapoint,
+    datapoint_schema,
+    register_datapoint,
+    validate_datapoint,
+    vitoconnect_ns,
+)
 
 DEPENDENCIES = ["vitoconnect"]
 OPTOLINKBinarySensor = vitoconnect_ns.class_(
-    "OPTOLINKBinarySensor", binary_sensor.BinarySensor
+    "OPTOLINKBinarySensor", binary_sensor.BinarySensor, Datapoint
 )
 
-CONFIG_SCHEMA = binary_sensor.binary_sensor_schema(OPTOLINKBinarySensor).extend(
-    {
-        cv.GenerateID(): cv.declare_id(OPTOLINKBinarySensor),
-        cv.GenerateID(CONF_VITOCONNECT_ID): cv.use_id(VitoConnect),
-        cv.Required(CONF_ADDRESS): cv.uint16_t,
-    }
+CONFIG_SCHEMA = cv.All(
+    binary_sensor.binary_sensor_schema(OPTOLINKBinarySensor)
+    .extend(
+        {
+            cv.GenerateID(): cv.declare_id(OPTOLINKBinarySensor),
+            cv.Optional(CONF_BITMASK): cv.hex_uint32_t,
+        }
+    )
+    .extend(datapoint_schema()),
+    validate_datapoint(default_length=1, numeric=True),
 )
 
 
 async def to_code(config):
     var = await binary_sensor.new_binary_sensor(config)
 
-    # Add configuration to datapoint
-    cg.add(var.setAddress(config[CONF_ADDRESS]))
-    cg.add(var.setLength(1))
-
-    # Add sensor to component hub (VitoConnect)
-    hub = await cg.get_variable(config[CONF_VITOCONNECT_ID])
-    cg.add(hub.register_datapoint(var))
+    # Add configuration to datapoint and sensor to component hub (VitoConnect)
+    await register_datapoint(var, config)
@@ -16,9 +16,8 @@ OPTOLINKBinarySensor::~OPTOLINKBinarySensor() {
 void OPTOLINKBinarySensor::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
   assert(length >= _length);
 
-  if (!dp) dp = this;
-
-  publish_state(data[0]);
+  // without bitmask any non-zero value is true
+  publish_state(decodeNumber(data) != 0.0f);
 }
 
 void OPTOLINKBinarySensor::encode(uint8_t* raw, uint8_t length, void* data) {
@@ -29,6 +28,7 @@ void OPTOLINKBinarySensor::encode(uint8_t* raw, uint8_t length, void* data) {
 void OPTOLINKBinarySensor::encode(uint8_t* raw, uint8_t length, float data) {
   assert(length >= _length);
 
+  encodeNumber(raw, (data != 0.0f) ? 1.0f : 0.0f);
 }
 
 }  // namespace vitoconnect
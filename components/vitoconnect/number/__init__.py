@@ -0,0 +1,46 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import number
+from esphome.const import CONF_MAX_VALUE, CONF_MIN_VALUE, CONF_STEP
+
+from .. import (
+    CONF_BITMASK,
+    CONF_DIVISOR,
+    Datapoint,
+    datapoint_schema,
+    register_datapoint,
+    validate_datapoint,
+    vitoconnect_ns,
+)
+
+DEPENDENCIES = ["vitoconnect"]
+OPTOLINKNumber = vitoconnect_ns.class_("OPTOLINKNumber", number.Number, Datapoint)
+
+CONFIG_SCHEMA = cv.All(
+    number.number_schema(OPTOLINKNumber)
+    .extend(
+        {
+            cv.GenerateID(): cv.declare_id(OPTOLINKNumber),
+            cv.Optional(CONF_BITMASK): cv.hex_uint32_t,
+            cv.Optional(CONF_DIVISOR): cv.int_range(min=1),
+            cv.Required(CONF_MIN_VALUE): cv.float_,
+            cv.Required(CONF_MAX_VALUE): cv.float_,
+            cv.Optional(CONF_STEP, default=1): cv.positive_float,
+        }
+    )
+    .extend(datapoint_schema()),
+    validate_datapoint(writable=True),
+)
+
+
+async def to_code(config):
+    var = await number.new_number(
+        config,
+        min_value=config[CONF_MIN_VALUE],
+        max_value=config[CONF_MAX_VALUE],
+        step=config[CONF_STEP],
+    )
+
+    # Add configuration to datapoint and number to component hub (VitoConnect)
+    hub = await register_datapoint(var, config)
+    cg.add(var.set_parent(hub))
@@ -0,0 +1,41 @@
+#include "vitoconnect_number.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+static const char *TAG = "vitoconnect_number";
+
+OPTOLINKNumber::OPTOLINKNumber(){
+  // empty
+}
+
+OPTOLINKNumber::~OPTOLINKNumber() {
+  // empty
+}
+
+void OPTOLINKNumber::control(float value) {
+  // state is published once the Vitotronic confirmed the write
+  if (!parent_->write(this, value)) {
+    ESP_LOGW(TAG, "Could not schedule write of %f to address %x", value, _address);
+  }
+}
+
+void OPTOLINKNumber::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
+  assert(length >= _length);
+
+  publish_state(decodeNumber(data));
+}
+
+void OPTOLINKNumber::encode(uint8_t* raw, uint8_t length, void* data) {
+  float value = *reinterpret_cast<float*>(data);
+  encode(raw, length, value);
+}
+
+void OPTOLINKNumber::encode(uint8_t* raw, uint8_t length, float data) {
+  assert(length >= _length);
+
+  encodeNumber(raw, data);
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
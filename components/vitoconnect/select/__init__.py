@@ -0,0 +1,53 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import select
+
+from .. import (
+    CONF_BITMASK,
+    Datapoint,
+    datapoint_schema,
+    register_datapoint,
+    validate_datapoint,
+    vitoconnect_ns,
+)
+
+DEPENDENCIES = ["vitoconnect"]
+OPTOLINKSelect = vitoconnect_ns.class_("OPTOLINKSelect", select.Select, Datapoint)
+
+CONF_OPTIONSMAP = "optionsmap"
+
+
+def ensure_option_map(value):
+    cv.check_not_templatable(value)
+    options_map_schema = cv.Schema({cv.string_strict: cv.uint32_t})
+    value = options_map_schema(value)
+    if len(value) == 0:
+        raise cv.Invalid("At least one option must be defined.")
+    all_values = list(value.values())
+    if len(all_values) != len(set(all_values)):
+        raise cv.Invalid("Mapping values must be unique.")
+    return value
+
+
+CONFIG_SCHEMA = cv.All(
+    select.select_schema(OPTOLINKSelect)
+    .extend(
+        {
+            cv.GenerateID(): cv.declare_id(OPTOLINKSelect),
+            cv.Optional(CONF_BITMASK): cv.hex_uint32_t,
+            cv.Required(CONF_OPTIONSMAP): ensure_option_map,
+        }
+    )
+    .extend(datapoint_schema()),
+    validate_datapoint(default_length=1, writable=True),
+)
+
+
+async def to_code(config):
+    options_map = config[CONF_OPTIONSMAP]
+    var = await select.new_select(config, options=list(options_map.keys()))
+    cg.add(var.set_select_mappings(list(options_map.values())))
+
+    # Add configuration to datapoint and select to component hub (VitoConnect)
+    hub = await register_datapoint(var, config)
+    cg.add(var.set_parent(hub))
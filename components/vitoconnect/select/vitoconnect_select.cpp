@@ -0,0 +1,57 @@
+#include "vitoconnect_select.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+static const char *TAG = "vitoconnect_select";
+
+OPTOLINKSelect::OPTOLINKSelect(){
+  // empty
+}
+
+OPTOLINKSelect::~OPTOLINKSelect() {
+  // empty
+}
+
+void OPTOLINKSelect::control(const std::string &value) {
+  auto options = traits.get_options();
+  for (size_t i = 0; i < options.size() && i < _mappings.size(); ++i) {
+    if (options[i] == value) {
+      // state is published once the Vitotronic confirmed the write
+      if (!parent_->write(this, (float) _mappings[i])) {
+        ESP_LOGW(TAG, "Could not schedule write of %s to address %x", value.c_str(), _address);
+      }
+      return;
+    }
+  }
+  ESP_LOGW(TAG, "Invalid option %s", value.c_str());
+}
+
+void OPTOLINKSelect::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
+  assert(length >= _length);
+
+  uint32_t tmp = (uint32_t) decodeNumber(data);
+
+  auto options = traits.get_options();
+  for (size_t i = 0; i < options.size() && i < _mappings.size(); ++i) {
+    if (_mappings[i] == tmp) {
+      publish_state(options[i]);
+      return;
+    }
+  }
+  ESP_LOGW(TAG, "No option for value %u at address %x", tmp, _address);
+}
+
+void OPTOLINKSelect::encode(uint8_t* raw, uint8_t length, void* data) {
+  float value = *reinterpret_cast<float*>(data);
+  encode(raw, length, value);
+}
+
+void OPTOLINKSelect::encode(uint8_t* raw, uint8_t length, float data) {
+  assert(length >= _length);
+
+  encodeNumber(raw, data);
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "esphome/core/helpers.h"
+#include "esphome/components/select/select.h"
+#include "../vitoconnect.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+class OPTOLINKSelect : public select::Select, public Datapoint, public Parented<VitoConnect> {
+
+  public:
+    OPTOLINKSelect();
+    ~OPTOLINKSelect();
+
+    void set_select_mappings(std::vector<uint32_t> mappings) { this->_mappings = std::move(mappings); }
+
+    void decode(uint8_t* data, uint8_t length, Datapoint* dp = nullptr) override;
+    void encode(uint8_t* raw, uint8_t length, void* data) override;
+    void encode(uint8_t* raw, uint8_t length, float data);
+
+  protected:
+    void control(const std::string &value) override;
+
+    std::vector<uint32_t> _mappings;
+
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -1,30 +1,64 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import sensor
-from esphome.const import CONF_ADDRESS, CONF_LENGTH
 
-from .. import CONF_VITOCONNECT_ID, VitoConnect, vitoconnect_ns
+from .. import (
+    CONF_BITMASK,
+    CONF_DIVISOR,
+    Datapoint,
+    datapoint_schema,
+    register_datapoint,
+    validate_datapoint,
+    vitoconnect_ns,
+)
 
 DEPENDENCIES = ["vitoconnect"]
-OPTOLINKSensor = vitoconnect_ns.class_("OPTOLINKSensor", sensor.Sensor)
-
-CONFIG_SCHEMA = sensor.sensor_schema(OPTOLINKSensor).extend(
-    {
-        cv.GenerateID(): cv.declare_id(OPTOLINKSensor),
-        cv.GenerateID(CONF_VITOCONNECT_ID): cv.use_id(VitoConnect),
-        cv.Required(CONF_ADDRESS): cv.uint16_t,
-        cv.Required(CONF_LENGTH): cv.uint8_t,
-    }
+
+CONF_AGGREGATE = "aggregate"
+CONF_WINDOW = "window"
+CONF_SAMPLES = "samples"
+CONF_MIN = "min"
+CONF_MAX = "max"
+CONF_MEAN = "mean"
+
+OPTOLINKSensor = vitoconnect_ns.class_("OPTOLINKSensor", sensor.Sensor, Datapoint)
+
+CONFIG_SCHEMA = cv.All(
+    sensor.sensor_schema(OPTOLINKSensor)
+    .extend(
+        {
+            cv.GenerateID(): cv.declare_id(OPTOLINKSensor),
+            cv.Optional(CONF_DIVISOR): cv.int_range(min=1),
+            cv.Optional(CONF_BITMASK): cv.hex_uint32_t,
+            # publish once per window instead of every read
+            cv.Optional(CONF_AGGREGATE): cv.Schema(
+                {
+                    cv.Required(CONF_WINDOW): cv.positive_time_period_milliseconds,
+                    cv.Optional(CONF_SAMPLES, default=0): cv.int_range(
+                        min=0, max=1000
+                    ),
+                    cv.Optional(CONF_MIN): sensor.sensor_schema(),
+                    cv.Optional(CONF_MAX): sensor.sensor_schema(),
+                    cv.Optional(CONF_MEAN): sensor.sensor_schema(),
+                }
+            ),
+        }
+    )
+    .extend(datapoint_schema()),
+    validate_datapoint(numeric=True),
 )
 
 
 async def to_code(config):
     var = await sensor.new_sensor(config)
 
-    # Add configuration to datapoint
-    cg.add(var.setAddress(config[CONF_ADDRESS]))
-    cg.add(var.setLength(config[CONF_LENGTH]))
+    # Add configuration to datapoint and sensor to component hub (VitoConnect)
+    await register_datapoint(var, config)
 
-    # Add sensor to component hub (VitoConnect)
-    hub = await cg.get_variable(config[CONF_VITOCONNECT_ID])
-    cg.add(hub.register_datapoint(var))
+    if CONF_AGGREGATE in config:
+        aggregate = config[CONF_AGGREGATE]
+        cg.add(var.set_aggregate(aggregate[CONF_WINDOW], aggregate[CONF_SAMPLES]))
+        for key in (CONF_MIN, CONF_MAX, CONF_MEAN):
+            if key in aggregate:
+                sens = await sensor.new_sensor(aggregate[key])
+                cg.add(getattr(var, f"set_{key}_sensor")(sens))
@@ -1,8 +1,13 @@
 #include "vitoconnect_sensor.h"
 
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
 namespace esphome {
 namespace vitoconnect {
 
+static const char *TAG = "vitoconnect_sensor";
+
 OPTOLINKSensor::OPTOLINKSensor(){
   // empty
 }
@@ -14,23 +19,58 @@ OPTOLINKSensor::~OPTOLINKSensor() {
 void OPTOLINKSensor::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
   assert(length >= _length);
 
-  if (!dp) dp = this;
+  // type, bitmask and divisor are applied in integer arithmetic before publishing once
+  float value = decodeNumber(data);
+  if (_window) {
+    _aggregate(value, millis());
+  } else {
+    publish_state(value);
+  }
+}
 
-  
-  if (_length == 1){         // Commonly percentage with factor /2
-    publish_state((float) data[0]);
+void OPTOLINKSensor::set_aggregate(uint32_t window, uint16_t samples) {
+  _window = window;
+  // allocated once, the ring buffer is overwritten while polling
+  _samples.resize(samples);
+}
+
+void OPTOLINKSensor::_aggregate(float value, uint32_t now) {
+  if (!_samples.empty()) {
+    _samples[_nextSample] = {now, value};
+    _nextSample = (_nextSample + 1) % _samples.size();
+    if (_sampleCount < _samples.size()) ++_sampleCount;
   }
-  else if (_length == 2){   // Commonly temperature with factor /10 or /100
-    int16_t tmp = 0;
-    tmp = data[1] << 8 | data[0];
-    float value = tmp / 1.0f;
-    publish_state(value);
-  }  
-  else if (_length == 4){   // Commonly counter with different factors
-    uint32_t tmp = 0;
-    tmp = data[3] << 24 | data[2] << 16 | data[1] << 8 | data[0];
-    float value = tmp / 1.0f;
-    publish_state(value);
+
+  // a sample at the end of the window starts the next one
+  tick(now);
+  if (_windowCount == 0) {
+    _windowStart = now;
+    _windowMin = _windowMax = value;
+    _windowSum = 0;
+  }
+  if (value < _windowMin) _windowMin = value;
+  if (value > _windowMax) _windowMax = value;
+  _windowSum += value;
+  _windowLast = value;
+  ++_windowCount;
+}
+
+void OPTOLINKSensor::tick(uint32_t now) {
+  if (_windowCount == 0 || now - _windowStart < _window) return;
+  // the entity itself gets the last value
+  publish_state(_windowLast);
+  if (_minSensor) _minSensor->publish_state(_windowMin);
+  if (_maxSensor) _maxSensor->publish_state(_windowMax);
+  if (_meanSensor) _meanSensor->publish_state(_windowSum / _windowCount);
+  _windowCount = 0;
+}
+
+void OPTOLINKSensor::dump_samples() {
+  ESP_LOGI(TAG, "%s: %u samples", get_name().c_str(), (unsigned) _sampleCount);
+  size_t first = (_nextSample + _samples.size() - _sampleCount) % (_samples.empty() ? 1 : _samples.size());
+  for (size_t i = 0; i < _sampleCount; ++i) {
+    const Sample& sample = _samples[(first + i) % _samples.size()];
+    ESP_LOGI(TAG, "  %10u %g", (unsigned) sample.timestamp, sample.value);
   }
 }
 
@@ -42,21 +82,7 @@ void OPTOLINKSensor::encode(uint8_t* raw, uint8_t length, void* data) {
 void OPTOLINKSensor::encode(uint8_t* raw, uint8_t length, float data) {
   assert(length >= _length);
 
-  // Commonly temperature with factor /10 or /100
-  if (_length == 2){
-    int16_t tmp = floor((data) + 0.5);
-    raw[1] = tmp >> 8;
-    raw[0] = tmp & 0xFF;
-  }
-
-  // Commonly counter with different factors
-  if (_length == 4){
-    uint32_t tmp = floor((data) + 0.5f);
-    raw[3] = tmp >> 24;
-    raw[2] = tmp >> 16;
-    raw[1] = tmp >> 8;
-    raw[0] = tmp & 0xFF;
-  }
+  encodeNumber(raw, data);
 }
 
 }  // namespace vitoconnect
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "esphome/components/sensor/sensor.h"
 #include "../vitoconnect_datapoint.h"
 
@@ -15,6 +17,41 @@ class OPTOLINKSensor : public sensor::Sensor, public Datapoint {
     void decode(uint8_t* data, uint8_t length, Datapoint* dp = nullptr) override;
     void encode(uint8_t* raw, uint8_t length, void* data) override;
     void encode(uint8_t* raw, uint8_t length, float data);
+    void tick(uint32_t now) override;
+
+    // Aggregation: publish once per window (ms), keeping the last (samples).
+    // The window is closed by time, also if no reads come in anymore.
+    void set_aggregate(uint32_t window, uint16_t samples);
+    void set_min_sensor(sensor::Sensor* sensor) { this->_minSensor = sensor; }
+    void set_max_sensor(sensor::Sensor* sensor) { this->_maxSensor = sensor; }
+    void set_mean_sensor(sensor::Sensor* sensor) { this->_meanSensor = sensor; }
+
+    /**
+     * @brief Log the raw samples kept for aggregation, oldest first.
+     */
+    void dump_samples();
+
+  protected:
+    void _aggregate(float value, uint32_t now);
+
+    struct Sample {
+      uint32_t timestamp;
+      float value;
+    };
+    std::vector<Sample> _samples;
+    size_t _nextSample{0};
+    size_t _sampleCount{0};
+
+    uint32_t _window{0};
+    uint32_t _windowStart{0};
+    uint32_t _windowCount{0};
+    float _windowMin{0};
+    float _windowMax{0};
+    float _windowSum{0};
+    float _windowLast{0};
+    sensor::Sensor* _minSensor{nullptr};
+    sensor::Sensor* _maxSensor{nullptr};
+    sensor::Sensor* _meanSensor{nullptr};
 
 };
 
@@ -0,0 +1,35 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import switch
+
+from .. import (
+    CONF_BITMASK,
+    Datapoint,
+    datapoint_schema,
+    register_datapoint,
+    validate_datapoint,
+    vitoconnect_ns,
+)
+
+DEPENDENCIES = ["vitoconnect"]
+OPTOLINKSwitch = vitoconnect_ns.class_("OPTOLINKSwitch", switch.Switch, Datapoint)
+
+CONFIG_SCHEMA = cv.All(
+    switch.switch_schema(OPTOLINKSwitch)
+    .extend(
+        {
+            cv.GenerateID(): cv.declare_id(OPTOLINKSwitch),
+            cv.Optional(CONF_BITMASK): cv.hex_uint32_t,
+        }
+    )
+    .extend(datapoint_schema()),
+    validate_datapoint(default_length=1, writable=True),
+)
+
+
+async def to_code(config):
+    var = await switch.new_switch(config)
+
+    # Add configuration to datapoint and switch to component hub (VitoConnect)
+    hub = await register_datapoint(var, config)
+    cg.add(var.set_parent(hub))
@@ -0,0 +1,41 @@
+#include "vitoconnect_switch.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+static const char *TAG = "vitoconnect_switch";
+
+OPTOLINKSwitch::OPTOLINKSwitch(){
+  // empty
+}
+
+OPTOLINKSwitch::~OPTOLINKSwitch() {
+  // empty
+}
+
+void OPTOLINKSwitch::write_state(bool state) {
+  // state is published once the Vitotronic confirmed the write
+  if (!parent_->write(this, state ? 1.0f : 0.0f)) {
+    ESP_LOGW(TAG, "Could not schedule write to address %x", _address);
+  }
+}
+
+void OPTOLINKSwitch::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
+  assert(length >= _length);
+
+  publish_state(decodeNumber(data) != 0.0f);
+}
+
+void OPTOLINKSwitch::encode(uint8_t* raw, uint8_t length, void* data) {
+  float value = *reinterpret_cast<float*>(data);
+  encode(raw, length, value);
+}
+
+void OPTOLINKSwitch::encode(uint8_t* raw, uint8_t length, float data) {
+  assert(length >= _length);
+
+  encodeNumber(raw, (data != 0.0f) ? 1.0f : 0.0f);
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+#include "esphome/components/switch/switch.h"
+#include "../vitoconnect.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+class OPTOLINKSwitch : public switch_::Switch, public Datapoint, public Parented<VitoConnect> {
+
+  public:
+    OPTOLINKSwitch();
+    ~OPTOLINKSwitch();
+
+    void decode(uint8_t* data, uint8_t length, Datapoint* dp = nullptr) override;
+    void encode(uint8_t* raw, uint8_t length, void* data) override;
+    void encode(uint8_t* raw, uint8_t length, float data);
+
+  protected:
+    void write_state(bool state) override;
+
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
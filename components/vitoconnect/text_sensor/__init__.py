@@ -0,0 +1,53 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import text_sensor
+from esphome.const import CONF_TYPE
+
+from .. import (
+    NUMERIC_TYPES,
+    Datapoint,
+    datapoint_schema,
+    register_datapoint,
+    validate_datapoint,
+    vitoconnect_ns,
+)
+
+DEPENDENCIES = ["vitoconnect"]
+OPTOLINKTextSensor = vitoconnect_ns.class_(
+    "OPTOLINKTextSensor", text_sensor.TextSensor, Datapoint
+)
+
+CONF_MAP = "map"
+
+
+def validate_map(config):
+    if CONF_MAP in config and config[CONF_TYPE] not in NUMERIC_TYPES:
+        raise cv.Invalid(f"{CONF_MAP} is only supported for numeric types")
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    text_sensor.text_sensor_schema(OPTOLINKTextSensor)
+    .extend(
+        {
+            cv.GenerateID(): cv.declare_id(OPTOLINKTextSensor),
+            cv.Optional(CONF_MAP): cv.Schema({cv.uint32_t: cv.string_strict}),
+        }
+    )
+    .extend(
+        datapoint_schema(
+            NUMERIC_TYPES + ["systime", "cycletime", "raw"], type_required=True
+        )
+    ),
+    validate_datapoint(),
+    validate_map,
+)
+
+
+async def to_code(config):
+    var = await text_sensor.new_text_sensor(config)
+    for value, text in config.get(CONF_MAP, {}).items():
+        cg.add(var.add_mapping(value, text))
+
+    # Add configuration to datapoint and text sensor to component hub (VitoConnect)
+    await register_datapoint(var, config)
@@ -0,0 +1,47 @@
+#include "vitoconnect_text_sensor.h"
+
+#include <stdio.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+OPTOLINKTextSensor::OPTOLINKTextSensor(){
+  // empty
+}
+
+OPTOLINKTextSensor::~OPTOLINKTextSensor() {
+  // empty
+}
+
+void OPTOLINKTextSensor::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
+  assert(length >= _length);
+
+  switch (_type) {
+  case DP_SYSTIME:
+    publish_state(decodeSystime(data));
+    break;
+  case DP_CYCLETIME:
+    publish_state(decodeCycletime(data));
+    break;
+  case DP_RAW:
+    publish_state(decodeRaw(data, _length));
+    break;
+  default: {
+    // status enums: numeric value mapped to text
+    float value = decodeNumber(data);
+    for (size_t i = 0; i < _mapValues.size(); ++i) {
+      if (_mapValues[i] == value) {
+        publish_state(_mapTexts[i]);
+        return;
+      }
+    }
+    char buff[16];
+    snprintf(buff, sizeof(buff), "%g", value);
+    publish_state(buff);
+    break;
+  }
+  }
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "esphome/components/text_sensor/text_sensor.h"
+#include "../vitoconnect_datapoint.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+class OPTOLINKTextSensor : public text_sensor::TextSensor, public Datapoint {
+
+  public:
+    OPTOLINKTextSensor();
+    ~OPTOLINKTextSensor();
+
+    void add_mapping(uint32_t value, std::string text) {
+      this->_mapValues.push_back(value);
+      this->_mapTexts.push_back(std::move(text));
+    }
+
+    void decode(uint8_t* data, uint8_t length, Datapoint* dp = nullptr) override;
+
+  protected:
+    std::vector<uint32_t> _mapValues;
+    std::vector<std::string> _mapTexts;
+
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
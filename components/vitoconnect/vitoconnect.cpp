@@ -19,28 +19,67 @@
 
 #include "vitoconnect.h"
 
+#include <algorithm>
+#include <cmath>
+
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+
 namespace esphome {
 namespace vitoconnect {
 
 static const char *TAG = "vitoconnect";
 
+// preferences have a fixed size, values are saved in chunks of this size
+static const uint8_t PERSIST_CHUNK_SIZE = 32;
+struct PersistChunk {
+  uint8_t data[PERSIST_CHUNK_SIZE];
+};
+
+// datapoints polled faster than update_interval are scheduled from loop()
+static const uint32_t SCHEDULER_TICK_MS = 100;
+
 void VitoConnect::setup() {
 
     this->check_uart_settings(4800, 2, uart::UART_CONFIG_PARITY_EVEN, 8);
 
     ESP_LOGD(TAG, "Starting optolink with protocol: %s", this->protocol.c_str());
+    OptolinkTransport* transport = _capture ? (OptolinkTransport*) &_captureTransport : &_transport;
+    if (_capture) _captureTransport.resize(CAPTURE_BUFFER_LINES);
     if (this->protocol.compare("P300") == 0) {
-        _optolink = new OptolinkP300(this);
+        _optolink = new OptolinkP300(transport, &_transport);
     } else if (this->protocol.compare("KW") == 0) {
-        _optolink = new OptolinkKW(this);
+        _optolink = new OptolinkKW(transport, &_transport);
     } else if (this->protocol.compare("GWG") == 0) {
-        _optolink = new OptolinkGWG(this);
+        OptolinkGWG* gwg = new OptolinkGWG(transport, &_transport);
+        gwg->setBurstLimit(_burstLimit);
+        _optolink = gwg;
     } else {
       ESP_LOGW(TAG, "Unknown protocol.");
     }
 
-    // optimize datapoint list
+    // optimize datapoint list, sorted by address for write-through lookups
     _datapoints.shrink_to_fit();
+    std::sort(_datapoints.begin(), _datapoints.end(), [](Datapoint* a, Datapoint* b) {
+      return a->getAddress() < b->getAddress();
+    });
+    size_t writable = _datapoints.size();
+    for (Datapoint* dp : _datapoints) writable += dp->childCount();
+    _writeArgs.reserve(writable);
+    for (Datapoint* dp : _datapoints) {
+      dp->setNextUpdate(millis());
+      _writeArgs.emplace_back(this, dp, true);
+      for (uint8_t i = 0; i < dp->childCount(); ++i) _writeArgs.emplace_back(this, dp->child(i), true);
+      uint32_t interval = dp->isAdaptive() ? dp->getMinInterval() : dp->getUpdateInterval();
+      if (interval && interval < this->get_update_interval()) _tick = SCHEDULER_TICK_MS;
+    }
+    _buildReadGroups();
+    uint8_t maxLength = 0;
+    for (const ReadGroup& group : _groups) {
+      maxLength = std::max(maxLength, group.length);
+    }
+    _buffer.resize(maxLength);
+    _pending.reserve(_groups.size());
 
     if (_optolink) {
 
@@ -48,9 +87,13 @@ void VitoConnect::setup() {
       _optolink->onData(&VitoConnect::_onData);
       _optolink->onError(&VitoConnect::_onError);
       
+      _optolink->trace().resize(_traceBuffer);
+
       // set initial state
       _optolink->begin();
 
+      if (_restoreValues) _restore();
+
     } else {
       ESP_LOGW(TAG, "Not able to initialize VitoConnect");
     }
@@ -61,34 +104,486 @@ void VitoConnect::register_datapoint(Datapoint *datapoint) {
     this->_datapoints.push_back(datapoint);
 }
 
+void VitoConnect::_buildReadGroups() {
+  // Datapoints are sorted by address, so identical and overlapping ones
+  // follow each other. Merging overlapping ranges never needs more bytes
+  // on the bus than reading them separately.
+  _groups.clear();
+  for (Datapoint* dp : _datapoints) {
+    uint32_t start = dp->getAddress();
+    uint32_t end = start + dp->getLength();
+    if (!_groups.empty()) {
+      ReadGroup& group = _groups.back();
+      uint32_t groupEnd = (uint32_t) group.address + group.length;
+      uint32_t unionEnd = std::max(end, groupEnd);
+      if (start < groupEnd && unionEnd - group.address <= 0xFF) {
+        group.length = unionEnd - group.address;
+        group.datapoints.push_back(dp);
+        continue;
+      }
+    }
+    _groups.push_back(ReadGroup{dp->getAddress(), dp->getLength(), {dp}});
+  }
+  _groups.shrink_to_fit();
+  // the groups don't move anymore
+  for (ReadGroup& group : _groups) {
+    group.arg = CbArg(this, &group);
+  }
+}
+
+void VitoConnect::dump_config() {
+  ESP_LOGCONFIG(TAG, "VitoConnect:");
+  ESP_LOGCONFIG(TAG, "  Protocol: %s", this->protocol.c_str());
+  ESP_LOGCONFIG(TAG, "  Datapoints: %u", (unsigned) _datapoints.size());
+  ESP_LOGCONFIG(TAG, "  Bus reads per update: %u", (unsigned) _groups.size());
+  if (_capture) ESP_LOGCONFIG(TAG, "  Capturing all optolink bytes to the log");
+  for (const ReadGroup& group : _groups) {
+    if (group.datapoints.size() > 1) {
+      ESP_LOGCONFIG(TAG, "    Address %x, length %d shared by %u datapoints",
+                    group.address, group.length, (unsigned) group.datapoints.size());
+    }
+  }
+}
+
 void VitoConnect::loop() {
+    _loopStart = micros();
+    // idle loops don't count towards the time per transaction
+    const OptolinkStats& stats = _optolink->stats();
+    uint32_t bytes = stats.txBytes + stats.rxBytes;
+    bool decoding = !_pending.empty();
+    uint32_t finished = stats.transactions + stats.errorCount();
+    _decodePending();
     _optolink->loop();
+    if (_tick && millis() - _lastTick >= _tick) {
+        _lastTick = millis();
+        _poll(_lastTick);
+    }
+    if (_capture) {
+        // log between transactions only
+        _captureTransport.poll(_optolink->queueSize() == 0 || stats.transactions + stats.errorCount() != finished);
+    }
+    if (_sweepStart && _optolink->queueSize() == 0) {
+        _sweepDuration = millis() - _sweepStart;
+        _sweepStart = 0;
+    }
+    uint32_t elapsed = micros() - _loopStart;
+    _loopTiming.add(elapsed);
+    if (decoding || stats.txBytes + stats.rxBytes != bytes) _transactionTime += elapsed;
+}
+
+bool VitoConnect::_overBudget() {
+  return _loopBudget && micros() - _loopStart > _loopBudget;
+}
+
+void VitoConnect::_decodePending() {
+  // oldest first, the bytes are taken from the shadow image
+  size_t done = 0;
+  while (done < _pending.size() && !_overBudget()) {
+    ReadGroup* group = _pending[done++];
+    group->pending = false;
+    if (_shadow.fetch(group->address, group->length, _buffer.data(), nullptr)) {
+      _dispatch(group, _buffer.data(), group->length);
+    }
+  }
+  _pending.erase(_pending.begin(), _pending.begin() + done);
 }
 
 void VitoConnect::update() {
   // This will be called every "update_interval" milliseconds.
   ESP_LOGD(TAG, "Schedule sensor update");
+  if (!_optolink) return;
   
-  for (Datapoint* dp : this->_datapoints) {
-      CbArg* arg = new CbArg(this, dp);   
-      if (_optolink->read(dp->getAddress(), dp->getLength(), reinterpret_cast<void*>(arg))) {
+  uint32_t now = millis();
+  _publishStatistics(now);
+  _poll(now);
+
+  if (_restoreValues && _persistDirty && now - _lastPersist >= _persistInterval) {
+      _persistValues();
+  }
+}
+
+void VitoConnect::_poll(uint32_t now) {
+  for (ReadGroup& group : this->_groups) {
+      // read if any datapoint is due, the others are refreshed along
+      // (not due: value is still fresh, eg. from a confirmed write)
+      // (held back: poll condition not met and no slower interval)
+      bool due = false;
+      for (Datapoint* dp : group.datapoints) {
+          bool conditionMet = _conditionMet(dp);
+          if (conditionMet && dp->getElseInterval()) {
+              // the slower interval ends with the condition, not at its deadline
+              dp->advanceNextUpdate(dp->getLastPoll() + _pollInterval(dp, true));
+          }
+          due |= dp->isDue(now) && (dp->getElseInterval() || conditionMet);
+      }
+      if (!due || _decodeFresh(group, now)) continue;
+
+      if (_read(group, now) && !_sweepStart) {
+          _sweepStart = now;
+      }
+  }
+  for (Datapoint* dp : _datapoints) {
+      dp->tick(now);
+  }
+}
+
+bool VitoConnect::_decodeFresh(ReadGroup& group, uint32_t now) {
+  // Bytes stored after the group's own read (all of them written) are
+  // decoded from the shadow image instead of read again, as long as they
+  // are younger than the datapoints' intervals.
+  uint32_t timestamp;
+  if (!_shadow.fetch(group.address, group.length, nullptr, &timestamp) ||
+      (int32_t) (timestamp - group.stored) <= 0) {
+    return false;
+  }
+  for (Datapoint* dp : group.datapoints) {
+    if (now - timestamp >= _pollInterval(dp, !dp->getElseInterval() || _conditionMet(dp))) return false;
+  }
+  for (Datapoint* dp : group.datapoints) {
+    _scheduleNext(dp, timestamp);
+  }
+  if (!group.pending) {
+    group.pending = true;
+    _pending.push_back(&group);
+  }
+  return true;
+}
+
+bool VitoConnect::_read(ReadGroup& group, uint32_t now) {
+  if (!_optolink->read(group.address, group.length, reinterpret_cast<void*>(&group.arg))) {
+    return false;
+  }
+  for (Datapoint* dp : group.datapoints) {
+    _scheduleNext(dp, now);
+  }
+  return true;
+}
+
+void VitoConnect::_restore() {
+  // layout: per read group one valid flag followed by its bytes
+  std::string layout;
+  size_t size = 0;
+  for (const ReadGroup& group : _groups) {
+    layout += str_sprintf("%x:%u,", group.address, group.length);
+    size += 1 + group.length;
+  }
+  // a changed configuration gets new keys and thus starts empty
+  uint32_t hash = fnv1_hash(layout);
+  size_t chunks = (size + PERSIST_CHUNK_SIZE - 1) / PERSIST_CHUNK_SIZE;
+  for (size_t i = 0; i < chunks; ++i) {
+    _persist.push_back(global_preferences->make_preference<PersistChunk>(hash + i));
+  }
+
+  std::vector<uint8_t> blob(chunks * PERSIST_CHUNK_SIZE);
+  for (size_t i = 0; i < chunks; ++i) {
+    if (!_persist[i].load(reinterpret_cast<PersistChunk*>(&blob[i * PERSIST_CHUNK_SIZE]))) {
+      ESP_LOGD(TAG, "No saved values");
+      return;
+    }
+  }
+
+  // publish the saved values, marked stale in the shadow image so that
+  // they are read first
+  uint32_t now = millis();
+  uint32_t stale = now - this->get_update_interval();
+  size_t restored = 0;
+  uint8_t* pos = blob.data();
+  for (ReadGroup& group : _groups) {
+    if (pos[0]) {
+      _shadow.store(group.address, &pos[1], group.length, stale);
+      group.stored = stale;
+      _dispatch(&group, &pos[1], group.length, false);
+      ++restored;
+      bool once = true;
+      for (Datapoint* dp : group.datapoints) {
+        once &= dp->getPollMode() == POLL_ONCE;
+      }
+      if (once) {
+        // restored values of read-once datapoints are final
+        for (Datapoint* dp : group.datapoints) dp->unschedule();
       } else {
-          delete arg;
+        _read(group, now);
       }
+    }
+    pos += 1 + group.length;
+  }
+  ESP_LOGI(TAG, "Published %u saved values, refreshing", (unsigned) restored);
+}
+
+void VitoConnect::_persistValues() {
+  if (_persist.empty()) return;
+  std::vector<uint8_t> blob(_persist.size() * PERSIST_CHUNK_SIZE, 0);
+  uint8_t* pos = blob.data();
+  for (const ReadGroup& group : _groups) {
+    pos[0] = _shadow.fetch(group.address, group.length, &pos[1], nullptr);
+    pos += 1 + group.length;
+  }
+  for (size_t i = 0; i < _persist.size(); ++i) {
+    _persist[i].save(reinterpret_cast<PersistChunk*>(&blob[i * PERSIST_CHUNK_SIZE]));
   }
+  _persistDirty = false;
+  _lastPersist = millis();
+  ESP_LOGD(TAG, "Saved values");
+}
+
+void VitoConnect::on_safe_shutdown() {
+  // eg. before an OTA update, preferences are synced afterwards
+  if (_restoreValues && _persistDirty) _persistValues();
+}
+
+void VitoConnect::_publishStatistics(uint32_t now) {
+  OptolinkStats& stats = _optolink->stats();
+  uint32_t elapsed = now - _lastStatistics;
+  uint32_t bytes = stats.txBytes + stats.rxBytes;
+  // 4800 baud 8E2: 12 bits per byte on the wire
+  float busy = (bytes - _lastBytes) * 12 * 1000.0f / 4800;
+
+  _publishStatistic(STAT_TRANSACTIONS, stats.transactions);
+  _publishStatistic(STAT_ERRORS, stats.errorCount());
+  _publishStatistic(STAT_TIMEOUT_ERRORS, stats.errors[TIMEOUT]);
+  _publishStatistic(STAT_LENGTH_ERRORS, stats.errors[LENGTH]);
+  _publishStatistic(STAT_NACK_ERRORS, stats.errors[NACK]);
+  _publishStatistic(STAT_CRC_ERRORS, stats.errors[CRC]);
+  _publishStatistic(STAT_DEVICE_ERRORS, stats.errors[VITO_ERROR]);
+  _publishStatistic(STAT_TX_BYTES, stats.txBytes);
+  _publishStatistic(STAT_RX_BYTES, stats.rxBytes);
+  _publishStatistic(STAT_RTT_P50, stats.rttPercentile(50));
+  _publishStatistic(STAT_RTT_P95, stats.rttPercentile(95));
+  _publishStatistic(STAT_RTT_MAX, stats.rttMax);
+  _publishStatistic(STAT_QUEUE_HIGH_WATER, stats.queueHighWater);
+  if (elapsed > 0) _publishStatistic(STAT_BUS_UTILIZATION, busy * 100 / elapsed);
+  _publishStatistic(STAT_SWEEP_DURATION, _sweepDuration);
+  _publishStatistic(STAT_LOOP_TIME_MAX, _loopTiming.max);
+  _publishStatistic(STAT_LOOP_TIME_AVG, _loopTiming.avg());
+  _publishStatistic(STAT_PUBLISH_TIME_MAX, _publishTiming.max);
+  _publishStatistic(STAT_PUBLISH_TIME_AVG, _publishTiming.avg());
+  _publishStatistic(STAT_DEFERRED_DECODES, _deferred);
+  _publishStatistic(STAT_RECOVERIES, stats.recoveries);
+  _publishStatistic(STAT_RECOVERY_TIME_MAX, stats.recoveryMax);
+  _publishStatistic(STAT_DISCARDED_ANSWERS, stats.discarded);
+  if (_logStatistics) _logStatisticsLine(elapsed, busy);
+  _loopTiming.reset();
+  _publishTiming.reset();
+  _transactionTime = 0;
+
+  stats.resetWindow();
+  _lastStatistics = now;
+  _lastBytes = bytes;
+  _lastTransactions = stats.transactions;
+}
+
+void VitoConnect::_logStatisticsLine(uint32_t elapsed, float busy) {
+  // One JSON object per update, to be collected from the log and compared
+  // between firmware versions
+  const OptolinkStats& stats = _optolink->stats();
+  uint32_t transactions = stats.transactions - _lastTransactions;
+  ESP_LOGI(TAG, "stats {\"protocol\":\"%s\",\"datapoints\":%u,\"reads\":%u,"
+                "\"interval_ms\":%u,\"transactions\":%u,\"per_minute\":%.1f,"
+                "\"errors\":%u,\"sweep_ms\":%u,\"rtt_p50_ms\":%u,\"rtt_p99_ms\":%u,"
+                "\"rtt_max_ms\":%u,\"recovery_max_ms\":%u,\"utilization\":%.1f,"
+                "\"cpu_us_per_transaction\":%.0f}",
+           this->protocol.c_str(), (unsigned) _datapoints.size(), (unsigned) _groups.size(),
+           (unsigned) elapsed, (unsigned) transactions,
+           elapsed ? transactions * 60000.0f / elapsed : 0.0f,
+           (unsigned) stats.errorCount(), (unsigned) _sweepDuration,
+           (unsigned) stats.rttPercentile(50), (unsigned) stats.rttPercentile(99),
+           (unsigned) stats.rttMax, (unsigned) stats.recoveryMax, elapsed ? busy * 100 / elapsed : 0.0f,
+           transactions ? (float) _transactionTime / transactions : 0.0f);
+}
+
+void VitoConnect::_publishStatistic(Statistic statistic, float value) {
+  if (_statistics[statistic]) _statistics[statistic]->publish_state(value);
+}
+
+void VitoConnect::_scheduleNext(Datapoint* dp, uint32_t now) {
+  if (dp->getPollMode() != POLL_ALWAYS) {
+    // static value, read again only on request
+    dp->unschedule();
+    return;
+  }
+  dp->setLastPoll(now);
+  dp->setNextUpdate(now + _pollInterval(dp, !dp->getElseInterval() || _conditionMet(dp)));
+}
+
+uint32_t VitoConnect::_pollInterval(Datapoint* dp, bool conditionMet) {
+  uint32_t interval = this->get_update_interval();
+  if (dp->getUpdateInterval()) interval = dp->getUpdateInterval();
+  if (dp->isAdaptive()) interval = dp->getInterval();
+  if (!conditionMet) interval = dp->getElseInterval();
+  // checked every tick, at most one tick late
+  if (_tick) return interval;
+  // checked once per update, some slack for timer jitter
+  return interval - interval / 8;
+}
+
+bool VitoConnect::_conditionMet(Datapoint* dp) {
+  Datapoint* guard = dp->getGuard();
+  if (!guard) return true;
+  // the guard's last value is taken from the shadow image, as long as it
+  // is unknown the datapoint is polled as usual
+  uint8_t raw[8];
+  if (guard->getLength() > sizeof(raw) ||
+      !_shadow.fetch(guard->getAddress(), guard->getLength(), raw, nullptr)) {
+    return true;
+  }
+  float value = guard->decodeNumber(raw);
+  return std::isnan(value) || fabsf(value - dp->getGuardValue()) < 0.001f;
+}
+
+bool VitoConnect::refresh(Datapoint* datapoint) {
+  if (!_optolink) return false;
+  uint32_t start = datapoint->getAddress();
+  uint32_t end = start + datapoint->getLength();
+  for (ReadGroup& group : _groups) {
+    // also finds datapoints inside a block
+    if (group.address <= start && (uint32_t) group.address + group.length >= end) {
+      return _read(group, millis());
+    }
+  }
+  ESP_LOGW(TAG, "No datapoint registered for address %x", datapoint->getAddress());
+  return false;
+}
+
+void VitoConnect::dump_shadow() {
+  _shadow.dump(millis());
+}
+
+void VitoConnect::dump_trace() {
+  if (!_optolink || !_optolink->trace().enabled()) {
+    ESP_LOGW(TAG, "Optolink trace is disabled, set trace_buffer");
+    return;
+  }
+  _optolink->trace().dump();
+}
+
+bool VitoConnect::write(Datapoint* datapoint, float value) {
+  if (!_optolink) return false;
+
+  uint16_t address = datapoint->getAddress();
+  uint8_t length = datapoint->getLength();
+  if (length > MAX_DP_LENGTH) {
+    ESP_LOGW(TAG, "Datapoint with address %x is too long for writing", address);
+    return false;
+  }
+  uint8_t raw[MAX_DP_LENGTH] = {0};
+  if (datapoint->getBitmask() && !_optolink->pendingWrite(address, length, raw)) {
+    // the other bits are written back unchanged, so they have to be known
+    if (!_shadow.fetch(address, length, raw, nullptr)) {
+      ESP_LOGW(TAG, "Value at address %x not read yet, write dropped", address);
+      return false;
+    }
+  }
+  datapoint->encode(raw, length, &value);
+
+  // only the latest value of repeated writes has to be sent
+  if (_optolink->updateWrite(address, length, raw)) {
+    ESP_LOGD(TAG, "Updated pending write to address %x", address);
+    return true;
+  }
+
+  auto it = std::find_if(_writeArgs.begin(), _writeArgs.end(),
+                         [datapoint](const CbArg& arg) { return arg.dp == datapoint; });
+  if (it == _writeArgs.end()) {
+    ESP_LOGW(TAG, "No datapoint registered for address %x", address);
+    return false;
+  }
+  ESP_LOGD(TAG, "Schedule write to address %x", address);
+  CbArg* arg = &*it;
+  if (_optolink->write(address, length, raw, reinterpret_cast<void*>(arg))) {
+    return true;
+  }
+  ESP_LOGW(TAG, "Queue full, write to address %x dropped", address);
+  return false;
 }
 
 void VitoConnect::_onData(uint8_t* data, uint8_t len, void* arg) {
   CbArg* cbArg = reinterpret_cast<CbArg*>(arg);
-  cbArg->dp->decode(data, len, cbArg->dp);
-  delete cbArg;
+  if (cbArg->write) {
+    cbArg->v->_writeThrough(cbArg->dp, data, len);
+  } else {
+    VitoConnect* v = cbArg->v;
+    ReadGroup* group = cbArg->group;
+    group->stored = millis();
+    v->_persistDirty |= v->_shadow.store(group->address, data, len, group->stored);
+    if (v->_overBudget() || group->pending) {
+      // decode from the shadow image in the next loop
+      if (!group->pending) {
+        group->pending = true;
+        v->_pending.push_back(group);
+        ++v->_deferred;
+      }
+    } else {
+      v->_dispatch(group, data, len);
+    }
+  }
+}
+
+void VitoConnect::_dispatch(ReadGroup* group, uint8_t* data, uint8_t len, bool live) {
+  uint32_t start = micros();
+  // every subscriber decodes its own bytes of the shared read
+  for (Datapoint* dp : group->datapoints) {
+    uint8_t offset = dp->getAddress() - group->address;
+    uint8_t length = dp->getLength();
+    if (offset + length > len) continue;
+    if (dp->isAdaptive() && live) {
+      dp->adaptInterval(dp->decodeNumber(&data[offset]), millis());
+      // the next poll was scheduled with the old interval when it was sent
+      _scheduleNext(dp, dp->getLastPoll());
+    }
+    dp->decode(&data[offset], length, dp);
+  }
+  _publishTiming.add(micros() - start);
+}
+
+void VitoConnect::_writeThrough(Datapoint* writer, uint8_t* data, uint8_t len) {
+  // A confirmed write updates every datapoint covering the written bytes,
+  // so no read back is needed to publish the new value. A group written
+  // as a whole is decoded from the shadow image at its next poll instead
+  // of read (see _decodeFresh()).
+  uint16_t address = writer->getAddress();
+  bool published = false;
+  uint32_t writeEnd = (uint32_t) address + len;
+  uint32_t now = millis();
+  _persistDirty |= _shadow.store(address, data, len, now);
+  for (Datapoint* dp : this->_datapoints) {
+    uint32_t start = dp->getAddress();
+    uint32_t end = start + dp->getLength();
+    if (start >= writeEnd) break;  // sorted by address, no more overlaps
+    if (end <= address) continue;
+
+    if (!_shadow.fetch(dp->getAddress(), dp->getLength(), _buffer.data(), nullptr)) {
+      // partially written and nothing known about the other bytes
+      continue;
+    }
+    dp->decode(_buffer.data(), dp->getLength(), dp);
+    // the writer itself or the block holding it
+    published |= (start <= address && end >= writeEnd);
+  }
+
+  if (!published) {
+    // writer is part of a block whose other bytes are still unknown
+    writer->decode(data, len, writer);
+  }
 }
 
 void VitoConnect::_onError(uint8_t error, void* arg) {
   ESP_LOGD(TAG, "Error received: %d", error);
   CbArg* cbArg = reinterpret_cast<CbArg*>(arg);
-  if (cbArg->v->_onErrorCb) cbArg->v->_onErrorCb(error, cbArg->dp);
-  delete cbArg;
+  if (cbArg->group) {
+    // read-once datapoints have to be tried again
+    for (Datapoint* dp : cbArg->group->datapoints) {
+      if (dp->getPollMode() != POLL_ALWAYS) dp->setNextUpdate(millis());
+    }
+  }
+  if (cbArg->v->_onErrorCb) {
+    if (cbArg->group) {
+      for (Datapoint* dp : cbArg->group->datapoints) {
+        cbArg->v->_onErrorCb(error, dp);
+      }
+    } else {
+      cbArg->v->_onErrorCb(error, cbArg->dp);
+    }
+  }
 }
 
 }  // namespace vitoconnect
@@ -28,13 +28,45 @@
 #include "vitoconnect_optolinkP300.h"
 #include "vitoconnect_optolinkKW.h"
 #include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_transportESPHome.h"
+#include "vitoconnect_transportCapture.h"
 #include "vitoconnect_datapoint.h"
+#include "vitoconnect_block.h"
+#include "vitoconnect_shadow.h"
 
 using namespace std;
 
 namespace esphome {
 namespace vitoconnect {
 
+// Bus statistics that can be published as sensors
+enum Statistic : uint8_t {
+  STAT_TRANSACTIONS,
+  STAT_ERRORS,
+  STAT_TIMEOUT_ERRORS,
+  STAT_LENGTH_ERRORS,
+  STAT_NACK_ERRORS,
+  STAT_CRC_ERRORS,
+  STAT_DEVICE_ERRORS,
+  STAT_TX_BYTES,
+  STAT_RX_BYTES,
+  STAT_RTT_P50,
+  STAT_RTT_P95,
+  STAT_RTT_MAX,
+  STAT_QUEUE_HIGH_WATER,
+  STAT_BUS_UTILIZATION,
+  STAT_SWEEP_DURATION,
+  STAT_LOOP_TIME_MAX,
+  STAT_LOOP_TIME_AVG,
+  STAT_PUBLISH_TIME_MAX,
+  STAT_PUBLISH_TIME_AVG,
+  STAT_DEFERRED_DECODES,
+  STAT_RECOVERIES,
+  STAT_RECOVERY_TIME_MAX,
+  STAT_DISCARDED_ANSWERS,
+  STAT_COUNT
+};
+
 /**
  * @brief VitoConnect manages the esphome components, their datapoints and optolink to your Viessmann device.
  * 
@@ -47,9 +79,19 @@ class VitoConnect : public uart::UARTDevice, public PollingComponent {
     void setup() override;
     void loop() override;
     void update() override;
+    void dump_config() override;
+    void on_safe_shutdown() override;
 
     void set_protocol(std::string protocol) { this->protocol = protocol; }
     void register_datapoint(Datapoint *datapoint);
+    void set_restore_values(bool restore) { this->_restoreValues = restore; }
+    void set_persist_interval(uint32_t interval) { this->_persistInterval = interval; }
+    void set_trace_buffer(uint16_t records) { this->_traceBuffer = records; }
+    void set_loop_budget(uint32_t budget) { this->_loopBudget = budget; }
+    void set_burst_limit(uint8_t limit) { this->_burstLimit = limit; }
+    void set_log_statistics(bool log) { this->_logStatistics = log; }
+    void set_capture(bool capture) { this->_capture = capture; }
+    void set_statistic_sensor(Statistic statistic, sensor::Sensor* sensor) { this->_statistics[statistic] = sensor; }
 
     void onData(std::function<void(const uint8_t* data, uint8_t length, Datapoint* dp)> callback);
     void onError(std::function<void(uint8_t, Datapoint*)> callback);
@@ -57,34 +99,150 @@ class VitoConnect : public uart::UARTDevice, public PollingComponent {
     /**
      * @brief Enqueue a datapoint for writing.
      * 
-     * The onData callback will be launched on success.
+     * The value is encoded by the datapoint itself. If a write to the same
+     * address is still waiting in the queue, only its value is replaced.
+     * The datapoint's decode will be launched on success.
      * 
-     * @tparam D Type of datapoint (inherited from class `Datapoint`)
-     * @tparam T Type of the value to be written
-     * @param datapoint Datapoint to be read, passed by reference.
+     * @param datapoint Datapoint to be written.
      * @param value Value to be written
      * @return true Enqueueing was successful
      * @return false Enqueueing failed (eg. queue full)
      */
-    // template<class D, typename T>
-    // bool write(D& datapoint, T value);  // NOLINT todo: make it a const ref or pointer?
+    bool write(Datapoint* datapoint, float value);
+
+    /**
+     * @brief Log the shadow image, all bytes known from the device.
+     */
+    void dump_shadow();
+
+    /**
+     * @brief Log the last frames on the optolink (needs trace_buffer).
+     */
+    void dump_trace();
+
+    /**
+     * @brief Read a datapoint now, eg. one that is only read once.
+     * 
+     * The whole read group holding the datapoint is read.
+     * 
+     * @param datapoint Datapoint to be read.
+     * @return true Enqueueing was successful
+     * @return false Enqueueing failed (eg. queue full or unknown datapoint)
+     */
+    bool refresh(Datapoint* datapoint);
 
   protected:
 
   private:
-    Optolink* _optolink;
+    ESPHomeTransport _transport{this};
+    // logs all bytes on the optolink when enabled
+    CaptureTransport _captureTransport{&_transport, &_transport};
+    bool _capture{false};
+    Optolink* _optolink{nullptr};
     std::vector<Datapoint*> _datapoints;
     std::string protocol;
+    uint8_t _burstLimit{0};
+
+    struct ReadGroup;
     struct CbArg {
-      CbArg(VitoConnect* vw, Datapoint* d) :
+      CbArg(VitoConnect* vw, Datapoint* d, bool w = false) :
+        v(vw),
+        dp(d),
+        group(nullptr),
+        write(w) {}
+      CbArg(VitoConnect* vw, ReadGroup* g) :
         v(vw),
-        dp(d) {}
+        dp(nullptr),
+        group(g),
+        write(false) {}
       VitoConnect* v;
       Datapoint* dp;
+      ReadGroup* group;
+      bool write;
     };
+
+    // Registered datapoints sharing bytes on the bus, read at once
+    struct ReadGroup {
+      uint16_t address;
+      uint8_t length;
+      std::vector<Datapoint*> datapoints;
+      bool pending{false};  // decode deferred to the next loop
+      uint32_t stored{0};   // time its last read was stored in the shadow image
+      CbArg arg{nullptr, this};  // callback argument of its reads, set once the groups are built
+    };
+    std::vector<ReadGroup> _groups;
+    // callback arguments of writes, one per datapoint and block child
+    std::vector<CbArg> _writeArgs;
+    // scheduler period in loop() for datapoints polled faster than
+    // update_interval, 0: only in update()
+    uint32_t _tick{0};
+    uint32_t _lastTick{0};
+
+    // Mirror of the device memory, fed by reads and confirmed writes
+    ShadowImage _shadow;
+    std::vector<uint8_t> _buffer;
+
+    // Last values of all read groups, saved in chunks to the preferences
+    bool _restoreValues{false};
+    uint32_t _persistInterval{0};
+    uint32_t _lastPersist{0};
+    bool _persistDirty{false};
+    std::vector<ESPPreferenceObject> _persist;
+
+    uint16_t _traceBuffer{0};
+
+    // Time spent in loop() and in decoding/publishing, in us
+    struct Timing {
+      uint32_t max{0};
+      uint32_t total{0};
+      uint32_t count{0};
+      void add(uint32_t us) {
+        if (us > max) max = us;
+        total += us;
+        ++count;
+      }
+      float avg() const { return count ? (float) total / count : 0; }
+      void reset() { max = total = count = 0; }
+    };
+    Timing _loopTiming;
+    Timing _publishTiming;
+    // decoding is deferred once loop() took longer than the budget (0: off)
+    uint32_t _loopBudget{0};
+    uint32_t _loopStart{0};
+    uint32_t _deferred{0};
+    std::vector<ReadGroup*> _pending;
+
+    // Bus statistics, published once per update
+    sensor::Sensor* _statistics[STAT_COUNT]{};
+    bool _logStatistics{false};
+    uint32_t _lastStatistics{0};
+    uint32_t _lastBytes{0};
+    uint32_t _lastTransactions{0};
+    uint32_t _transactionTime{0};  // loop time moving bytes or decoding, in us
+    uint32_t _sweepStart{0};
+    uint32_t _sweepDuration{0};
+
     static void _onData(uint8_t* data, uint8_t len, void* arg);
     static void _onError(uint8_t error, void* arg);
 
+    void _buildReadGroups();
+    void _poll(uint32_t now);
+    bool _read(ReadGroup& group, uint32_t now);
+    bool _decodeFresh(ReadGroup& group, uint32_t now);
+    void _restore();
+    void _persistValues();
+    void _publishStatistics(uint32_t now);
+    void _publishStatistic(Statistic statistic, float value);
+    void _logStatisticsLine(uint32_t elapsed, float busy);
+    // (live) false for saved values, which don't adapt poll intervals
+    void _dispatch(ReadGroup* group, uint8_t* data, uint8_t len, bool live = true);
+    bool _overBudget();
+    void _decodePending();
+    void _writeThrough(Datapoint* writer, uint8_t* data, uint8_t len);
+    void _scheduleNext(Datapoint* dp, uint32_t now);
+    uint32_t _pollInterval(Datapoint* dp, bool conditionMet);
+    bool _conditionMet(Datapoint* dp);
+
     std::function<void(uint8_t, Datapoint*)> _onErrorCb;
 };
 
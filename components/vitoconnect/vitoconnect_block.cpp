@@ -0,0 +1,58 @@
+/*
+  vitoconnect_block.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vitoconnect_block.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+DatapointBlock::DatapointBlock() {
+  // a block has no value of its own
+  setType(DP_RAW);
+}
+
+DatapointBlock::~DatapointBlock() {
+  // children are owned by esphome
+}
+
+void DatapointBlock::addChild(Datapoint* child, uint8_t offset) {
+  // rejected by the config validation already
+  assert(offset + child->getLength() <= _length);
+  if (offset + child->getLength() > _length) return;
+  child->setAddress(_address + offset);
+  _children.push_back({child, offset});
+}
+
+void DatapointBlock::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
+  if (length < _length) return;
+
+  // fan out the received buffer, each child decodes its own bytes
+  for (const Child& child : _children) {
+    child.dp->decode(&data[child.offset], child.dp->getLength(), child.dp);
+  }
+}
+
+void DatapointBlock::tick(uint32_t now) {
+  for (const Child& child : _children) {
+    child.dp->tick(now);
+  }
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
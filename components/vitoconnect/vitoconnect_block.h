@@ -0,0 +1,64 @@
+/*
+  vitoconnect_block.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "vitoconnect_datapoint.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief A range of bytes read at once and decoded into child datapoints.
+ * 
+ * Children sit at a byte offset inside the block (and may select single bits
+ * by their bitmask). Only the block is polled, so the bus cost is one read 
+ * per block regardless of the number of children.
+ */
+class DatapointBlock : public Datapoint {
+
+ public:
+  DatapointBlock();
+  ~DatapointBlock();
+
+  /**
+   * @brief Attach a child datapoint at (offset) bytes from the block address.
+   * 
+   * The child's address is set accordingly, so writes to a child go to the
+   * right address.
+   */
+  void addChild(Datapoint* child, uint8_t offset);
+
+  void decode(uint8_t* data, uint8_t length, Datapoint* dp = nullptr) override;
+  void tick(uint32_t now) override;
+  uint8_t childCount() override { return _children.size(); }
+  Datapoint* child(uint8_t index) override { return _children[index].dp; }
+
+ protected:
+  struct Child {
+    Datapoint* dp;
+    uint8_t offset;
+  };
+  std::vector<Child> _children;
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,102 @@
+/*
+  vitoconnect_codec.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vitoconnect_codec.h"
+
+#include <stdio.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+// indexed by DatapointType
+static const Codec CODECS[DP_TYPE_COUNT] = {
+  {1, &decodeInt<uint8_t>, &encodeInt<uint8_t>},    // DP_UINT8
+  {1, &decodeInt<int8_t>, &encodeInt<int8_t>},      // DP_INT8
+  {2, &decodeInt<uint16_t>, &encodeInt<uint16_t>},  // DP_UINT16
+  {2, &decodeInt<int16_t>, &encodeInt<int16_t>},    // DP_INT16
+  {4, &decodeInt<uint32_t>, &encodeInt<uint32_t>},  // DP_UINT32
+  {4, &decodeInt<int32_t>, &encodeInt<int32_t>},    // DP_INT32
+  {8, nullptr, nullptr},                            // DP_SYSTIME
+  {8, nullptr, nullptr},                            // DP_CYCLETIME
+  {0, nullptr, nullptr},                            // DP_RAW
+};
+
+const Codec* getCodec(DatapointType type) {
+  if (type >= DP_TYPE_COUNT) return nullptr;
+  return &CODECS[type];
+}
+
+DatapointType defaultType(uint8_t length) {
+  switch (length) {
+  case 1:
+    return DP_UINT8;   // Commonly percentage with factor /2
+  case 2:
+    return DP_INT16;   // Commonly temperature with factor /10 or /100
+  case 4:
+    return DP_UINT32;  // Commonly counter with different factors
+  default:
+    return DP_RAW;
+  }
+}
+
+float scale(int64_t value, uint32_t divisor) {
+  if (divisor <= 1) return static_cast<float>(value);
+  int64_t integral = value / static_cast<int64_t>(divisor);
+  int64_t remainder = value % static_cast<int64_t>(divisor);
+  return static_cast<float>(integral) + static_cast<float>(remainder) / divisor;
+}
+
+static inline uint8_t fromBcd(uint8_t value) {
+  return (value >> 4) * 10 + (value & 0x0F);
+}
+
+std::string decodeSystime(const uint8_t* data) {
+  // invalid BCD decodes up to 165 (0xFF), 3 digits per field
+  char buff[28];
+  snprintf(buff, sizeof(buff), "%02u%02u-%02u-%02u %02u:%02u:%02u",
+           fromBcd(data[0]), fromBcd(data[1]), fromBcd(data[2]), fromBcd(data[3]),
+           fromBcd(data[5]), fromBcd(data[6]), fromBcd(data[7]));
+  return std::string(buff);
+}
+
+std::string decodeCycletime(const uint8_t* data) {
+  std::string result;
+  char buff[12];
+  for (uint8_t i = 0; i < 8; i += 2) {
+    if (data[i] == 0xFF) continue;  // pair not in use
+    snprintf(buff, sizeof(buff), "%02u:%02u-%02u:%02u",
+             data[i] >> 3, (data[i] & 0x07) * 10, data[i + 1] >> 3, (data[i + 1] & 0x07) * 10);
+    if (!result.empty()) result += ", ";
+    result += buff;
+  }
+  return result;
+}
+
+std::string decodeRaw(const uint8_t* data, uint8_t length) {
+  std::string result;
+  char buff[4];
+  for (uint8_t i = 0; i < length; ++i) {
+    snprintf(buff, sizeof(buff), i == 0 ? "%02X" : " %02X", data[i]);
+    result += buff;
+  }
+  return result;
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
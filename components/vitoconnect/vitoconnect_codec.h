@@ -0,0 +1,135 @@
+/*
+  vitoconnect_codec.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file vitoconnect_codec.h
+ * @brief Codecs for the Viessmann datapoint formats.
+ *
+ * Every datapoint type has an entry in a table holding its length and the
+ * decoder/encoder for the raw little-endian bytes. The integer codecs are 
+ * templates, so each type gets its own specialised function.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <limits>
+#include <type_traits>
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Datapoint types as selected by `type:` in YAML.
+ */
+enum DatapointType : uint8_t {
+  DP_UINT8 = 0,
+  DP_INT8,
+  DP_UINT16,
+  DP_INT16,
+  DP_UINT32,
+  DP_INT32,
+  DP_SYSTIME,    ///< BCD date and time, 8 bytes
+  DP_CYCLETIME,  ///< Timer with four on/off pairs, 8 bytes
+  DP_RAW,        ///< Plain bytes, length from configuration
+  DP_TYPE_COUNT
+};
+
+/**
+ * @brief Codec table entry.
+ * 
+ * Textual types have no integer decoder/encoder (nullptr).
+ */
+struct Codec {
+  uint8_t length;                                 //!< Length in bytes, 0 if variable
+  int64_t (*decode)(const uint8_t* data);         //!< Decode raw bytes to integer
+  void (*encode)(uint8_t* raw, int64_t value);    //!< Encode integer to raw bytes
+};
+
+/**
+ * @brief Decode a little-endian integer of type T.
+ */
+template<typename T>
+int64_t decodeInt(const uint8_t* data) {
+  typedef typename std::make_unsigned<T>::type U;
+  U tmp = 0;
+  for (size_t i = sizeof(T); i > 0; --i) {
+    tmp = static_cast<U>(tmp << 8) | data[i - 1];
+  }
+  return static_cast<T>(tmp);
+}
+
+/**
+ * @brief Encode an integer as little-endian T, clamped to the range of T.
+ */
+template<typename T>
+void encodeInt(uint8_t* raw, int64_t value) {
+  typedef typename std::make_unsigned<T>::type U;
+  if (value < std::numeric_limits<T>::min()) value = std::numeric_limits<T>::min();
+  if (value > std::numeric_limits<T>::max()) value = std::numeric_limits<T>::max();
+  U tmp = static_cast<U>(static_cast<T>(value));
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    raw[i] = tmp & 0xFF;
+    tmp = static_cast<U>(tmp >> 8);
+  }
+}
+
+/**
+ * @brief Get the codec of a datapoint type.
+ * 
+ * @param type Datapoint type.
+ * @return const Codec* Table entry, nullptr for an unknown type.
+ */
+const Codec* getCodec(DatapointType type);
+
+/**
+ * @brief Default type of the legacy `length:` only configuration.
+ * 
+ * 1 byte is uint8, 2 bytes int16 and 4 bytes uint32. Other lengths are raw.
+ */
+DatapointType defaultType(uint8_t length);
+
+/**
+ * @brief Scale an integer by a divisor.
+ * 
+ * The integral part is divided in integer arithmetic first, so large 
+ * counters (eg. seconds to hours) keep their precision as float.
+ */
+float scale(int64_t value, uint32_t divisor);
+
+/**
+ * @brief Decode BCD date and time (YYYY MM DD WD hh mm ss) to 
+ *        "YYYY-MM-DD hh:mm:ss".
+ */
+std::string decodeSystime(const uint8_t* data);
+
+/**
+ * @brief Decode a timer (four on/off pairs, hour << 3 | minute / 10) to
+ *        "hh:mm-hh:mm" pairs. Unused pairs (0xFF) are skipped.
+ */
+std::string decodeCycletime(const uint8_t* data);
+
+/**
+ * @brief Hex representation of raw bytes, eg. "20 4B 01".
+ */
+std::string decodeRaw(const uint8_t* data, uint8_t length);
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -25,6 +25,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "vitoconnect_datapoint.h"
 
+#include <math.h>
+
 namespace esphome {
 namespace vitoconnect {
 
@@ -42,6 +44,74 @@ void Datapoint::onData(std::function<void(uint8_t[], uint8_t, Datapoint* dp)> ca
   _stdOnData = callback;
 }
 
+void Datapoint::setLength(uint8_t length) {
+  _length = length;
+  if (!_codec) {
+    // legacy configuration without type
+    setType(defaultType(length));
+  }
+}
+
+void Datapoint::setType(DatapointType type) {
+  _type = type;
+  _codec = getCodec(type);
+  if (_codec && _codec->length > 0 && _codec->length != _length) {
+    _length = _codec->length;
+  }
+}
+
+void Datapoint::setAdaptiveInterval(uint32_t min, uint32_t max, float threshold) {
+  _minInterval = min;
+  _maxInterval = max;
+  _threshold = threshold;
+  // start fast until the rate of change is known
+  _interval = min;
+}
+
+void Datapoint::adaptInterval(float value, uint32_t now) {
+  if (isnan(value)) return;
+  if (!isnan(_lastValue) && now != _lastValueMillis) {
+    // time the value needs to change by the threshold at the recent rate
+    float change = fabsf(value - _lastValue);
+    float target = (change > 0) ? _threshold * (now - _lastValueMillis) / change : _maxInterval;
+    if (target < _minInterval) target = _minInterval;
+    if (target > _maxInterval) target = _maxInterval;
+    // move halfway, a single outlier doesn't pin the interval
+    _interval = (_interval + (uint32_t) target) / 2;
+  }
+  _lastValue = value;
+  _lastValueMillis = now;
+}
+
+void Datapoint::setBitmask(uint32_t bitmask) {
+  _bitmask = bitmask;
+  _bitshift = 0;
+  while (bitmask && !(bitmask & 0x01)) {
+    bitmask >>= 1;
+    ++_bitshift;
+  }
+}
+
+float Datapoint::decodeNumber(const uint8_t* data) {
+  if (!_codec || !_codec->decode) return NAN;
+  int64_t value = _codec->decode(data);
+  if (_bitmask) value = (value & _bitmask) >> _bitshift;
+  return scale(value, _divisor);
+}
+
+void Datapoint::encodeNumber(uint8_t* raw, float value) {
+  if (!_codec || !_codec->encode) {
+    memset(raw, 0, _length);
+    return;
+  }
+  int64_t encoded = llroundf(value * _divisor);
+  if (_bitmask && _codec->decode) {
+    int64_t current = _codec->decode(raw);
+    encoded = (current & ~(int64_t) _bitmask) | ((encoded << _bitshift) & _bitmask);
+  }
+  _codec->encode(raw, encoded);
+}
+
 void Datapoint::encode(uint8_t* raw, uint8_t length, void* data) {
   if (length != _length) {
     // display error about length
@@ -52,15 +122,12 @@ void Datapoint::encode(uint8_t* raw, uint8_t length, void* data) {
 }
 
 void Datapoint::decode(uint8_t* data, uint8_t length, Datapoint* dp) {
-  uint8_t* output = new uint8_t[_length];
-  memset(output, 0, _length);
   if (length != _length) {
     // display error about length
   } else {
-    memcpy(output, data, length);
-    if (_stdOnData) _stdOnData(output, _length, dp);
+    // data stays valid during the callback, no copy needed
+    if (_stdOnData) _stdOnData(data, _length, dp);
   }
-  delete[] output;
 }
 
 }  // namespace vitoconnect
@@ -28,11 +28,22 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <stdint.h>
 #include <assert.h>
 #include <functional>
+#include <math.h>
 #include <string.h>  // for memcpy
+#include <vector>
+
+#include "vitoconnect_codec.h"
 
 namespace esphome {
 namespace vitoconnect {
 
+// When a datapoint is read from the device
+enum PollMode : uint8_t {
+  POLL_ALWAYS,   // every update interval
+  POLL_ONCE,     // once, not at all if its value was restored
+  POLL_ON_BOOT,  // once after every boot
+};
+
 class Datapoint {
 
  public:
@@ -42,18 +53,91 @@ class Datapoint {
   void setAddress(uint16_t address) {  this->_address = address; };
   uint16_t getAddress() { return this->_address; };
   
-  void setLength(uint8_t length) {  this->_length = length; };
+  void setLength(uint8_t length);
   uint8_t getLength() { return this->_length; };
 
+  // Codec of the datapoint, sets the length for fixed size types
+  void setType(DatapointType type);
+  void setDivisor(uint32_t divisor) { this->_divisor = divisor; };
+  void setBitmask(uint32_t bitmask);
+  uint32_t getBitmask() { return this->_bitmask; };
+
+  // Numeric value of the raw data by codec, bitmask and divisor
+  float decodeNumber(const uint8_t* data);
+  // with a bitmask only the masked bits of (raw) are changed, the others
+  // have to hold the current value
+  void encodeNumber(uint8_t* raw, float value);
+
+  // Poll scheduling, a datapoint is read again once its next update is due
+  void setPollMode(PollMode mode) { this->_pollMode = mode; };
+  PollMode getPollMode() { return this->_pollMode; };
+  void setNextUpdate(uint32_t next) { this->_nextUpdate = next; this->_scheduled = true; };
+  void unschedule() { this->_scheduled = false; };
+  // Poll interval of this datapoint, 0: the hub's update_interval
+  void setUpdateInterval(uint32_t interval) { this->_updateInterval = interval; };
+  uint32_t getUpdateInterval() { return this->_updateInterval; };
+  bool isDue(uint32_t now) { return this->_scheduled && (int32_t) (now - this->_nextUpdate) >= 0; };
+  // only moves the next update forward, eg. when a slower interval ends
+  void advanceNextUpdate(uint32_t next) {
+    if ((int32_t) (next - this->_nextUpdate) < 0) this->_nextUpdate = next;
+  };
+  void setLastPoll(uint32_t now) { this->_lastPoll = now; };
+  uint32_t getLastPoll() { return this->_lastPoll; };
+
+  // Conditional polling: read every update interval only while (guard) has
+  // (value), otherwise every (interval) ms, 0: not at all
+  void setPollCondition(Datapoint* guard, float value, uint32_t interval) {
+    this->_guard = guard;
+    this->_guardValue = value;
+    this->_elseInterval = interval;
+  };
+  Datapoint* getGuard() { return this->_guard; };
+  float getGuardValue() { return this->_guardValue; };
+  uint32_t getElseInterval() { return this->_elseInterval; };
+
+  // Adaptive polling: the interval follows the rate of change of the value,
+  // so that it changes by about (threshold) between two reads
+  void setAdaptiveInterval(uint32_t min, uint32_t max, float threshold);
+  bool isAdaptive() { return this->_maxInterval > 0; };
+  uint32_t getInterval() { return this->_interval; };
+  uint32_t getMinInterval() { return this->_minInterval; };
+  void adaptInterval(float value, uint32_t now);
+
   static void onData(std::function<void(uint8_t[], uint8_t, Datapoint* dp)> callback);
   void onError(uint8_t, Datapoint* dp);
 
   virtual void encode(uint8_t* raw, uint8_t length, void* data);
   virtual void decode(uint8_t* data, uint8_t length, Datapoint* dp = nullptr);
+  // Called by the hub's scheduler, also without new data, eg. to close
+  // time windows
+  virtual void tick(uint32_t now) {}
+  // Datapoints decoded from this one's data (blocks), not registered at
+  // the hub themselves
+  virtual uint8_t childCount() { return 0; }
+  virtual Datapoint* child(uint8_t index) { return nullptr; }
 
  protected:
   uint16_t _address;
   uint8_t _length;
+  DatapointType _type{DP_RAW};
+  const Codec* _codec{nullptr};
+  uint32_t _divisor{1};
+  uint32_t _bitmask{0};
+  uint8_t _bitshift{0};
+  PollMode _pollMode{POLL_ALWAYS};
+  bool _scheduled{true};
+  uint32_t _nextUpdate{0};
+  uint32_t _updateInterval{0};
+  uint32_t _lastPoll{0};
+  Datapoint* _guard{nullptr};
+  float _guardValue{0};
+  uint32_t _elseInterval{0};
+  uint32_t _minInterval{0};
+  uint32_t _maxInterval{0};
+  uint32_t _interval{0};
+  float _threshold{0};
+  float _lastValue{NAN};
+  uint32_t _lastValueMillis{0};
   static std::function<void(uint8_t[], uint8_t, Datapoint* dp)> _stdOnData;
 };
 
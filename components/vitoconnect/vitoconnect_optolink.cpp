@@ -28,8 +28,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 namespace esphome {
 namespace vitoconnect {
 
-Optolink::Optolink(uart::UARTDevice* uart) :
-  _uart(uart),
+Optolink::Optolink(OptolinkTransport* transport, OptolinkClock* clock) :
+  _transport(transport),
+  _clock(clock),
   _queue(VITOWIFI_MAX_QUEUE_LENGTH),
   _onData(nullptr),
   _onError(nullptr) {}
@@ -55,23 +56,123 @@ void Optolink::onError(OnErrorArgCallback callback) {
 }
 
 bool Optolink::read(uint16_t address, uint8_t length, void* arg) {
+  if (length > MAX_DP_LENGTH && _chunkBuffer.size() < length) {
+    _chunkBuffer.resize(length);
+  }
   OptolinkDP dp(address, length, false, nullptr, arg);
-  return _queue.push(dp);
+  if (!_queue.push(dp)) return false;
+  if (_queue.size() == 1) _progressMillis = _millis();
+  if (_queue.size() > _stats.queueHighWater) _stats.queueHighWater = _queue.size();
+  return true;
 }
 
 bool Optolink::write(uint16_t address, uint8_t length, uint8_t* data, void* arg) {
+  if (length > MAX_DP_LENGTH) return false;
   OptolinkDP dp(address, length, true, data, arg);
-  return _queue.push(dp);
+  if (!_queue.push(dp)) return false;
+  if (_queue.size() == 1) _progressMillis = _millis();
+  if (_queue.size() > _stats.queueHighWater) _stats.queueHighWater = _queue.size();
+  return true;
+}
+
+bool Optolink::updateWrite(uint16_t address, uint8_t length, uint8_t* data) {
+  // skip the front item, it could be in transmission already
+  for (size_t i = 1; i < _queue.size(); ++i) {
+    OptolinkDP* dp = _queue.at(i);
+    if (dp->write && dp->address == address && dp->length == length) {
+      memcpy(dp->data, data, length);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Optolink::pendingWrite(uint16_t address, uint8_t length, uint8_t* data) {
+  // the latest one wins, the queue is sent in order
+  for (size_t i = _queue.size(); i > 0; --i) {
+    OptolinkDP* dp = _queue.at(i - 1);
+    if (dp->write && dp->address == address && dp->length == length) {
+      memcpy(data, dp->data, length);
+      return true;
+    }
+  }
+  return false;
 }
 
 void Optolink::_tryOnData(uint8_t* data, uint8_t len) {
+  ++_stats.transactions;
+  _stats.addRtt(_millis() - _requestMillis);
+  if (_failureMillis) {
+    _stats.addRecovery(_millis() - _failureMillis);
+    _failureMillis = 0;
+  }
   if (_onData) _onData(data, len, _queue.front()->arg);
   _queue.pop();
+  _progressMillis = _millis();
 }
 
 void Optolink::_tryOnError(uint8_t error) {
+  if (error < OPTOLINK_ERROR_TYPES) ++_stats.errors[error];
+  if (!_failureMillis) _failureMillis = _millis() | 1;  // never 0
+  if (_trace.enabled()) _trace.add(_millis(), TRACE_ERROR, _traceState(), &error, 1);
   if (_onError) _onError(error, _queue.front()->arg);
   _queue.pop();
+  _progressMillis = _millis();
+}
+
+void Optolink::_writeBytes(const uint8_t* data, size_t len) {
+  _stats.txBytes += len;
+  if (_trace.enabled()) _trace.add(_millis(), TRACE_TX, _traceState(), data, len);
+  _transport->write(data, len);
+}
+
+void Optolink::_sendRequest(const uint8_t* data, size_t len) {
+  if (_queue.front()->offset == 0) {
+    // first chunk of the datapoint
+    _requestMillis = _millis();
+  }
+  _writeBytes(data, len);
+}
+
+uint8_t Optolink::_readByte() {
+  ++_stats.rxBytes;
+  uint8_t data = _transport->read();
+  if (_trace.enabled()) _trace.add(_millis(), TRACE_RX, _traceState(), &data, 1);
+  return data;
+}
+
+void Optolink::_drainInput() {
+  while (_transport->available()) {
+    _readByte();
+  }
+}
+
+uint16_t Optolink::_chunkAddress() {
+  OptolinkDP* dp = _queue.front();
+  return dp->address + dp->offset;
+}
+
+uint8_t Optolink::_chunkLength() {
+  OptolinkDP* dp = _queue.front();
+  uint8_t remaining = dp->length - dp->offset;
+  return (remaining > MAX_DP_LENGTH) ? MAX_DP_LENGTH : remaining;
+}
+
+bool Optolink::_tryOnChunk(uint8_t* data, uint8_t len) {
+  OptolinkDP* dp = _queue.front();
+  if (dp->offset == 0 && len >= dp->length) {
+    // datapoint fits in a single transfer, as writes always do
+    _tryOnData(data, dp->length);
+    return true;
+  }
+  memcpy(&_chunkBuffer[dp->offset], data, len);
+  dp->offset += len;
+  if (dp->offset < dp->length) {
+    _progressMillis = _millis();
+    return false;
+  }
+  _tryOnData(_chunkBuffer.data(), dp->length);
+  return true;
 }
 
 }  // namespace vitoconnect
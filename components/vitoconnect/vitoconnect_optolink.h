@@ -68,17 +68,15 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
    */
   #define VITOWIFI_MAX_QUEUE_LENGTH 48
 #endif
-#ifndef MAX_DP_LENGTH
-  /** @brief Maximum size in bytes of a datapoint
-   */
-  #define MAX_DP_LENGTH 9
-#endif
 
-#include "esphome/components/uart/uart.h"
 #include <string.h>  // for memcpy
+#include <vector>
 
 #include "vitoconnect_simpleQueue.h"
 #include "vitoconnect_optolinkDP.h"
+#include "vitoconnect_optolinkStats.h"
+#include "vitoconnect_optolinkTrace.h"
+#include "vitoconnect_transport.h"
 
 namespace esphome {
 namespace vitoconnect {
@@ -109,9 +107,10 @@ class Optolink {
   /**
    * @brief Construct the Optolink object.
    * 
-   * @param uart UARTDevice object to be used. Pass by reference.
+   * @param transport Serial connection to the Vitotronic.
+   * @param clock Time source for the timeouts.
    */
-  explicit Optolink(uart::UARTDevice* uart);
+  Optolink(OptolinkTransport* transport, OptolinkClock* clock);
   virtual ~Optolink();
 
   /**
@@ -148,6 +147,9 @@ class Optolink {
    * Read (length) bytes from (address). On success, the data will be returned
    * by the onData handler; On error, the onError handler will be called.
    * 
+   * Datapoints longer than MAX_DP_LENGTH are read in chunks and passed to
+   * the onData handler at once.
+   * 
    * @param address Address of the datapoint (eg. 0x1234).
    * @param length Length in bytes of the datapoint. This is also the length
    *        of the value when writing.
@@ -162,6 +164,7 @@ class Optolink {
    * 
    * Write (length) bytes to (address). On success, the written data is
    * returned by the onData handler. On failure, the onError will be called.
+   * Writes are not split, they are a single transfer.
    * 
    * @param address Address of the datapoint (eg. 0x1234).
    * @param length Length in bytes of the datapoint. This is also the length
@@ -171,10 +174,40 @@ class Optolink {
    *        passing the this object.
    * @param arg Argument to use for the callback. Defaults to nullptr.
    * @return true Request was queued successfully.
-   * @return false Request could not be added to the queue (queue full?).
+   * @return false Request could not be added to the queue (queue full or
+   *         longer than MAX_DP_LENGTH).
    */
   bool write(uint16_t address, uint8_t length, uint8_t* data, void* arg = nullptr);
 
+  /**
+   * @brief Replace the value of a pending write request.
+   * 
+   * Looks for a queued write to (address) with the same length and 
+   * overwrites its value with (data). The first queue item is never 
+   * touched as it might already be on the wire. Use this to collapse 
+   * repeated writes to the same datapoint into the latest value.
+   * 
+   * @param address Address of the datapoint (eg. 0x1234).
+   * @param length Length in bytes of the value.
+   * @param data Pointer to the new value. This data will be copied.
+   * @return true A pending write has been updated, nothing new was queued.
+   * @return false No pending write to (address) found.
+   */
+  bool updateWrite(uint16_t address, uint8_t length, uint8_t* data);
+
+  /**
+   * @brief Value of the latest queued write to a datapoint.
+   * 
+   * Includes the first queue item, its value is sent unless it fails.
+   * 
+   * @param address Address of the datapoint (eg. 0x1234).
+   * @param length Length in bytes of the value.
+   * @param data Buffer of (length) bytes for the value.
+   * @return true (data) holds the value of a pending write.
+   * @return false No pending write to (address) found.
+   */
+  bool pendingWrite(uint16_t address, uint8_t length, uint8_t* data);
+
   /**
    * @brief Pure virtual method to start the Optolink (implemented in protocol 
    *        classes).
@@ -187,14 +220,57 @@ class Optolink {
    */
   virtual void loop() = 0;
 
+  /**
+   * @brief Number of requests waiting or in transmission.
+   */
+  size_t queueSize() const { return _queue.size(); }
+
+  /**
+   * @brief Bus statistics, the window values may be reset by the caller.
+   */
+  OptolinkStats& stats() { return _stats; }
+
+  /**
+   * @brief Trace of the last frames, disabled until it is resized.
+   */
+  OptolinkTrace& trace() { return _trace; }
+
 
  protected:
   void _tryOnData(uint8_t* data, uint8_t len);
   void _tryOnError(uint8_t error);
-  uart::UARTDevice* _uart;
+
+  uint32_t _millis() { return _clock->millis(); }
+
+  // Counted access to the transport, request frames also start the round trip timer
+  void _writeBytes(const uint8_t* data, size_t len);
+  void _sendRequest(const uint8_t* data, size_t len);
+  uint8_t _readByte();
+  // Discard everything received so far, eg. the rest of a broken frame
+  void _drainInput();
+  // Protocol state recorded in the trace
+  virtual uint8_t _traceState() const { return 0; }
+
+  // Front request made no progress for (timeout) ms, regardless of the
+  // protocol state and of line noise keeping the engine busy
+  bool _requestStuck(uint32_t timeout) { return _queue.size() > 0 && _millis() - _progressMillis > timeout; }
+
+  // Chunk of the front datapoint that is to be transferred next
+  uint16_t _chunkAddress();
+  uint8_t _chunkLength();
+  // Chunk has been transferred, returns true once the datapoint is complete
+  bool _tryOnChunk(uint8_t* data, uint8_t len);
+  std::vector<uint8_t> _chunkBuffer;  // reassembly of long reads, only one at a time
+  OptolinkTransport* _transport;
+  OptolinkClock* _clock;
   SimpleQueue<OptolinkDP> _queue;  // TODO(bertmelis): add semaphore to ESP32 version to guard access to queue
   OnDataArgCallback _onData;
   OnErrorArgCallback _onError;
+  OptolinkStats _stats;
+  OptolinkTrace _trace;
+  uint32_t _requestMillis{0};
+  uint32_t _progressMillis{0};  // front request queued or last chunk done
+  uint32_t _failureMillis{0};   // first failure since the last success, 0: none
 };
 
 }  // namespace vitoconnect
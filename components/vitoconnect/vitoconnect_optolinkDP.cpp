@@ -32,11 +32,11 @@ OptolinkDP::OptolinkDP(uint16_t address, uint8_t length, bool write, uint8_t* va
   address(address),
   length(length),
   write(write),
-  data(nullptr),
+  data{0},
+  offset(0),
   arg(arg) {
     if (write) {
-      data = new uint8_t[length];
-      memcpy(data, value, length);
+      memcpy(data, value, (length > MAX_DP_LENGTH) ? MAX_DP_LENGTH : length);
     }
   }
 
@@ -44,24 +44,9 @@ OptolinkDP::OptolinkDP() :
   address(0),
   length(0),
   write(false),
-  data(nullptr),
+  data{0},
+  offset(0),
   arg(nullptr) {}
 
-OptolinkDP::OptolinkDP(const OptolinkDP& obj) {
-  address = obj.address;
-  length = obj.length;
-  write = obj.write;
-  data = nullptr;
-  arg = obj.arg;
-  if (write) {
-    data = new uint8_t[length];
-    memcpy(data, obj.data, length);
-  }
-}
-
-OptolinkDP::~OptolinkDP() {
-  if (data) delete[] data;
-}
-
 }  // namespace vitoconnect
 }  // namespace esphome
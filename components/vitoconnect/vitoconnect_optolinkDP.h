@@ -32,6 +32,13 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #pragma once
 
+#ifndef MAX_DP_LENGTH
+  /** @brief Maximum size in bytes of a single transfer. Larger datapoints 
+   *         are split into chunks of this size.
+   */
+  #define MAX_DP_LENGTH 9
+#endif
+
 #include <stdint.h>
 #include <string.h>  // memcpy
 
@@ -54,7 +61,8 @@ class OptolinkDP {
    *              read/write (true)
    * @param value Pointer to data to write (set to nullptr when reading). This 
    *              data will be copied so it is allowed to go out of scope
-   *              after passing the this object.
+   *              after passing the this object. At most MAX_DP_LENGTH
+   *              bytes are copied.
    * @param arg Argument (const) to use for the callback (if not used, set to nullptr)
    */
   OptolinkDP(uint16_t address, uint8_t length, bool write, uint8_t* value, void* arg);
@@ -65,22 +73,11 @@ class OptolinkDP {
    */
   OptolinkDP();
 
-  /**
-   * @brief Copy constructor for the OptolinkDP class.
-   * 
-   * @param obj Object to be copied.
-   */
-  OptolinkDP(const OptolinkDP& obj);
-
-  /**
-   * @brief Destroy the OptolinkDP object
-   * 
-   */
-  ~OptolinkDP();
   uint16_t address;  //!< Address of the datapoint, 2 bytes
   uint8_t length;    //!< Length of the dataponit, 1 byte
   bool write;        //!< Mark the dataponit as writeable (true) or not (false)
-  uint8_t* data;     //!< Pointer to the (raw) data to be written. Memory is allocated by this class
+  uint8_t data[MAX_DP_LENGTH];  //!< (Raw) data to be written, held in place so queueing never allocates
+  uint8_t offset;    //!< Number of bytes already transferred when split into chunks
   void* arg;         //!< Argument to be used on the callback function
 };
 
@@ -85,6 +85,8 @@
 
 #include "vitoconnect_optolinkGWG.h"
 
+#include "esphome/core/log.h"
+
 namespace esphome {
 namespace vitoconnect {
 
@@ -100,8 +102,8 @@ static constexpr uint32_t GWG_RX_TOTAL_TIMEOUT_MS = 800UL;
 // Larger gaps indicate a broken or aborted frame.
 static constexpr uint32_t GWG_RX_INTERBYTE_TIMEOUT_MS = 80UL;
 
-OptolinkGWG::OptolinkGWG(uart::UARTDevice* uart) :
-  Optolink(uart),
+OptolinkGWG::OptolinkGWG(OptolinkTransport* transport, OptolinkClock* clock) :
+  Optolink(transport, clock),
   _state(UNDEF),
   _lastMillis(0),
   _sendMillis(0),
@@ -115,24 +117,13 @@ OptolinkGWG::OptolinkGWG(uart::UARTDevice* uart) :
 
 void OptolinkGWG::begin() {
   _state = INIT;
-  _lastMillis = millis();
+  _lastMillis = _millis();
   _sendMillis = 0;
   _lastRxMillis = 0;
   _readyMillis = 0;
   _burstActive = false;
 }
 
-// Helper function:
-// Drain the UART RX buffer completely.
-// This is required after protocol errors or timeouts to ensure that
-// delayed bytes (e.g. late 0x05 ready signals) are not misinterpreted
-// as part of a new response.
-void OptolinkGWG::_drain_uart_() {
-  while (_uart->available()) {
-    (void) _uart->read();
-  }
-}
-
 // Helper: validate function + direction and discard invalid queue entries.
 //
 // Address encoding:
@@ -190,6 +181,16 @@ bool OptolinkGWG::_drop_invalid_queue_entries_() {
       continue;
     }
 
+    // Chunks of long reads must stay within the 1-byte address range.
+    // Rejected by the config validation, the caller is told anyway.
+    if (addr + dp->length > 0x100) {
+      ESP_LOGW(TAG,
+               "GWG: discarding datapoint exceeding address range: addr=0x%02X len=%u full=0x%04X",
+               addr, (unsigned) dp->length, (unsigned) dp->address);
+      _tryOnError(LENGTH);
+      continue;
+    }
+
     // If function != 0x00, enforce direction match with dp->write.
     if (func != 0x00) {
       if ((requires_write && !dp->write) || (requires_read && dp->write)) {
@@ -228,15 +229,15 @@ void OptolinkGWG::loop() {
   }
 
   // Connection watchdog:
-  // If there are pending datapoints in the queue but no successful
-  // communication for a prolonged time, reset the protocol state.
-  // This protects against deadlocks caused by lost sync conditions.
-  if (_queue.size() > 0 && millis() - _lastMillis > 5000UL) {
+  // If the pending datapoint made no progress for a prolonged time, reset
+  // the protocol state. This protects against deadlocks caused by lost sync
+  // conditions, also while line noise keeps the receive path busy.
+  if (_requestStuck(5000UL)) {
     _tryOnError(TIMEOUT);
     _state = INIT;
     _burstActive = false;
-    _drain_uart_();
-    _lastMillis = millis();
+    _drainInput();
+    _lastMillis = _millis();
   }
 }
 
@@ -244,11 +245,11 @@ void OptolinkGWG::_init() {
   // INIT state:
   // The goal is to synchronize with the controller.
   // We wait for the READY byte (0x05) and discard everything else.
-  if (_uart->available()) {
-    uint8_t b = _uart->read();
+  if (_transport->available()) {
+    uint8_t b = _readByte();
     if (b == 0x05) {
       _state = IDLE;
-      _lastMillis = millis();
+      _lastMillis = _millis();
       _readyMillis = _lastMillis;
       return;
     }
@@ -265,21 +266,22 @@ void OptolinkGWG::_idle() {
   //   otherwise the controller may ignore the upcoming request.
   // - The first request of a polling sequence is started from this state.
   // - After that, burst mode may take over (SEND is triggered directly after RECEIVE).
-  if (_uart->available()) {
-    uint8_t b = _uart->read();
+  if (_transport->available()) {
+    uint8_t b = _readByte();
 
     if (b == 0x05) {
-      _readyMillis = millis();
+      _readyMillis = _millis();
       _lastMillis = _readyMillis;
 
       if (_queue.size() > 0) {
         // Start (or restart) a burst sequence.
         _burstActive = true;
+        _burstCount = 0;
 
         // ACK the READY byte.
         // This ACK must be sent only as reaction to 0x05, not for burst requests.
         const uint8_t ack[1] = {0x01};
-        _uart->write_array(ack, sizeof(ack));
+        _writeBytes(ack, sizeof(ack));
 
         // Proceed to SEND state to transmit the actual request frame.
         _state = SEND;
@@ -323,12 +325,12 @@ void OptolinkGWG::_send() {
     return;
   }
 
-  _drain_uart_();
+  _drainInput();
 
   OptolinkDP *dp = _queue.front();
   const uint8_t func = (dp->address >> 8) & 0xFF;
-  const uint8_t addr = dp->address & 0xFF;
-  const uint8_t length = dp->length;
+  const uint8_t addr = _chunkAddress() & 0xFF;
+  const uint8_t length = _chunkLength();
 
   // Select telegram byte (TYPE) based on function (MSB) and write flag.
   uint8_t type = 0x00;
@@ -385,18 +387,18 @@ void OptolinkGWG::_send() {
     // WRITE: append payload
     memcpy(&buff[4], dp->data, length);
     _rcvLen = 1;  // expected ACK length (kept as legacy behavior)
-    _uart->write_array(buff, 4 + length);
+    _sendRequest(buff, 4 + length);
   } else {
     // READ: no payload
     _rcvLen = length;  // expected response equals requested length (legacy behavior)
-    _uart->write_array(buff, 4);
+    _sendRequest(buff, 4);
   }
 
   _rcvBufferLen = 0;
   memset(_rcvBuffer, 0, sizeof(_rcvBuffer));
 
   // Store timestamps for timeout handling and diagnostics.
-  _sendMillis = millis();
+  _sendMillis = _millis();
   _lastRxMillis = _sendMillis;
   _lastMillis = _sendMillis;
 
@@ -412,8 +414,8 @@ void OptolinkGWG::_send() {
 void OptolinkGWG::_receive() {
   // RECEIVE state:
   // Collect response bytes until expected response length is met or a timeout occurs.
-  while (_uart->available() != 0) {
-    uint8_t b = _uart->read();
+  while (_transport->available() != 0) {
+    uint8_t b = _readByte();
 
     // Protect against buffer overflow.
     if (_rcvBufferLen >= sizeof(_rcvBuffer)) {
@@ -422,18 +424,18 @@ void OptolinkGWG::_receive() {
       memset(_rcvBuffer, 0, sizeof(_rcvBuffer));
       _state = INIT;
       _burstActive = false;
-      _drain_uart_();
-      _lastMillis = millis();
+      _drainInput();
+      _lastMillis = _millis();
       return;
     }
 
     _rcvBuffer[_rcvBufferLen++] = b;
-    _lastRxMillis = millis();
+    _lastRxMillis = _millis();
   }
 
   // Case 1: Complete response received.
   if (_rcvBufferLen == _rcvLen) {
-    uint32_t rx_time = millis() - _sendMillis;
+    uint32_t rx_time = _millis() - _sendMillis;
     OptolinkDP *dp = _queue.front();
     const uint8_t addr = dp->address & 0xFF;
 
@@ -442,9 +444,18 @@ void OptolinkGWG::_receive() {
 
     // Forward data to datapoint handler.
     // Note: Typically _tryOnData() will pop the datapoint from the queue (depending on base implementation).
-    _tryOnData(_rcvBuffer, _rcvBufferLen);
+    // A WRITE is only answered by an ACK (0x00), so the written value is returned instead.
+    // Long reads stay at the front of the queue until all chunks are done.
+    if (dp->write && _rcvBuffer[0] == 0x00) {
+      _tryOnChunk(dp->data, dp->length);
+    } else if (dp->write) {
+      _tryOnError(NACK);
+    } else {
+      _tryOnChunk(_rcvBuffer, _rcvBufferLen);
+    }
 
-    _lastMillis = millis();
+    _lastMillis = _millis();
+    ++_burstCount;
 
     // Burst mode behavior:
     // If further datapoints are queued, send the next request immediately.
@@ -452,7 +463,8 @@ void OptolinkGWG::_receive() {
     //
     // IMPORTANT:
     // - No ACK (0x01) is sent for burst requests, because 0x01 is only the ACK for READY (0x05).
-    if (_burstActive && _queue.size() > 0) {
+    // - The burst limit bounds the requests per READY for controllers that don't tolerate long bursts.
+    if (_burstActive && _queue.size() > 0 && (_burstLimit == 0 || _burstCount < _burstLimit)) {
       _state = SEND;
       return;
     }
@@ -466,31 +478,31 @@ void OptolinkGWG::_receive() {
   // Case 2: Inter-byte timeout.
   // Some bytes arrived, but the gap between them was too large.
   if (_rcvBufferLen > 0 &&
-      millis() - _lastRxMillis > GWG_RX_INTERBYTE_TIMEOUT_MS) {
+      _millis() - _lastRxMillis > GWG_RX_INTERBYTE_TIMEOUT_MS) {
     ESP_LOGD(TAG, "Inter-byte timeout: got %d expected %d",
              (int)_rcvBufferLen, (int)_rcvLen);
     _rcvBufferLen = 0;
     memset(_rcvBuffer, 0, sizeof(_rcvBuffer));
     _state = INIT;
     _burstActive = false;
-    _drain_uart_();
-    _lastMillis = millis();
+    _drainInput();
+    _lastMillis = _millis();
     return;
   }
 
   // Case 3: Total response timeout.
   // The response did not complete within the allowed time window.
-  if (millis() - _sendMillis > GWG_RX_TOTAL_TIMEOUT_MS) {
+  if (_millis() - _sendMillis > GWG_RX_TOTAL_TIMEOUT_MS) {
     ESP_LOGD(TAG, "RX total timeout: got %d expected %d waited=%lu ms",
              (int)_rcvBufferLen,
              (int)_rcvLen,
-             (unsigned long)(millis() - _sendMillis));
+             (unsigned long)(_millis() - _sendMillis));
     _rcvBufferLen = 0;
     memset(_rcvBuffer, 0, sizeof(_rcvBuffer));
     _state = INIT;
     _burstActive = false;
-    _drain_uart_();
-    _lastMillis = millis();
+    _drainInput();
+    _lastMillis = _millis();
     return;
   }
 
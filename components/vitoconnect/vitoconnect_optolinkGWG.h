@@ -63,11 +63,18 @@ namespace vitoconnect {
  */
 class OptolinkGWG : public Optolink {
  public:
-  explicit OptolinkGWG(uart::UARTDevice* uart);
+  OptolinkGWG(OptolinkTransport* transport, OptolinkClock* clock);
 
   void begin();
   void loop();
 
+  /**
+   * @brief Limit the number of requests sent per READY (0x05).
+   * 
+   * @param limit Requests per READY, 1 disables burst mode, 0 is unlimited.
+   */
+  void setBurstLimit(uint8_t limit) { _burstLimit = limit; }
+
  private:
   enum OptolinkState : uint8_t {
     INIT,
@@ -76,15 +83,13 @@ class OptolinkGWG : public Optolink {
     RECEIVE,
     UNDEF
   } _state;
+  uint8_t _traceState() const override { return _state; }
 
   void _init();
   void _idle();
   void _send();
   void _receive();
 
-  // Drain UART RX buffer to remove delayed or stale bytes.
-  void _drain_uart_();
-
   // Drop invalid datapoints from the queue (e.g. unsupported function or direction mismatch).
   // Returns true if a valid datapoint remains at the front of the queue, false if queue is empty.
   bool _drop_invalid_queue_entries_();
@@ -103,6 +108,8 @@ class OptolinkGWG : public Optolink {
 
   // Indicates whether we are inside a burst sequence (send next requests immediately)
   bool _burstActive;
+  uint8_t _burstLimit{0};
+  uint8_t _burstCount{0};
 
   bool _write;
 
@@ -25,19 +25,40 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "vitoconnect_optolinkKW.h"
 
+#include "esphome/core/log.h"
+
 namespace esphome {
 namespace vitoconnect {
 
 static const char *TAG = "vitoconnect";
 
-OptolinkKW::OptolinkKW(uart::UARTDevice* uart) :
-  Optolink(uart),
+// Timings for KW / 4800 baud 8E2:
+// - The Vitotronic sends its sync (0x05) about every 2 s while idle. Without
+//   sync for this long, the connection is set up again.
+static constexpr uint32_t KW_SYNC_TIMEOUT_MS = 5000UL;
+// - Right after an answer the next request can be sent without waiting for
+//   the next sync.
+static constexpr uint32_t KW_DIRECT_SEND_WINDOW_MS = 10UL;
+// - Reset (0x04) is repeated until a sync is received, in case the
+//   Vitotronic is still connected with the P300 protocol.
+static constexpr uint32_t KW_RESET_RETRY_MS = 1000UL;
+// - Maximum gap until the (rest of the) answer arrives.
+static constexpr uint32_t KW_RESPONSE_TIMEOUT_MS = 1000UL;
+// - Last resort if a request doesn't finish at all.
+static constexpr uint32_t KW_REQUEST_TIMEOUT_MS = 5000UL;
+// - A byte is 12 bits long.
+static constexpr uint32_t KW_BYTE_TIME_US = 12 * 1000000UL / 4800;
+
+OptolinkKW::OptolinkKW(OptolinkTransport* transport, OptolinkClock* clock) :
+  Optolink(transport, clock),
   _state(UNDEF),
   _lastMillis(0),
   _write(false),
   _rcvBuffer{0},
   _rcvBufferLen(0),
-  _rcvLen(0) {}
+  _rcvLen(0),
+  _sendMillis(0),
+  _sendDuration(0) {}
 
 void OptolinkKW::begin() {
   _state = INIT;
@@ -64,35 +85,35 @@ void OptolinkKW::loop() {
     // begin() not called
     break;
   }
-  if (_queue.size() > 0 && millis() - _lastMillis > 5000UL) {  // if no ACK is coming, reset connection
+  if (_requestStuck(KW_REQUEST_TIMEOUT_MS)) {  // request doesn't finish, reset connection
     _tryOnError(TIMEOUT);
     _state = INIT;
-    _uart->flush();
+    _drainInput();
   }
   // TODO(@bertmelis): move timeouts here, clear queue on timeout
 }
 
 void OptolinkKW::_init() {
-  if (_uart->available()) {
-    if (_uart->peek() == 0x05) {
+  if (_transport->available()) {
+    if (_transport->peek() == 0x05) {
       _state = IDLE;
       _idle();
     } else {
-      _uart->read();
+      _readByte();
     }
   } else {
-    if (millis() - _lastMillis > 1000UL) {  // try to reset if Vitotronic is in a connected state with the P300 protocol
-      _lastMillis = millis();
+    if (_millis() - _lastMillis > KW_RESET_RETRY_MS) {  // try to reset if Vitotronic is in a connected state with the P300 protocol
+      _lastMillis = _millis();
       const uint8_t buff[] = {0x04};
-      _uart->write_array(buff, sizeof(buff));
+      _writeBytes(buff, sizeof(buff));
     }
   }
 }
 
 void OptolinkKW::_idle() {
-  if (_uart->available()) {
-    if (_uart->read() == 0x05) {
-      _lastMillis = millis();
+  if (_transport->available()) {
+    if (_readByte() == 0x05) {
+      _lastMillis = _millis();
       if (_queue.size() > 0) {
         _state = SYNC;
       }
@@ -100,17 +121,17 @@ void OptolinkKW::_idle() {
       ESP_LOGD(TAG, "Received unexpected data");
       // received something unexpected
     }
-  } else if ((_queue.size() > 0) && (millis() - _lastMillis < 10UL)) {  // don't wait for 0x05 sync signal, send directly after last request
+  } else if ((_queue.size() > 0) && (_millis() - _lastMillis < KW_DIRECT_SEND_WINDOW_MS)) {  // don't wait for 0x05 sync signal, send directly after last request
     _state = SEND;
     _send();
-  } else if (millis() - _lastMillis > 5 * 1000UL) {
+  } else if (_millis() - _lastMillis > KW_SYNC_TIMEOUT_MS) {
     _state = INIT;
   }
 }
 
 void OptolinkKW::_sync() {
   const uint8_t buff[1] = {0x01};
-  _uart->write_array(buff, sizeof(buff));
+  _writeBytes(buff, sizeof(buff));
   _state = SEND;
   _send();
 }
@@ -118,8 +139,8 @@ void OptolinkKW::_sync() {
 void OptolinkKW::_send() {
   uint8_t buff[MAX_DP_LENGTH + 4];
   OptolinkDP* dp = _queue.front();
-  uint8_t length = dp->length;
-  uint16_t address = dp->address;
+  uint8_t length = _chunkLength();
+  uint16_t address = _chunkAddress();
   if (dp->write) {
     // type is WRITE, has length of 4 chars + length of value
     buff[0] = 0xF4;
@@ -129,7 +150,8 @@ void OptolinkKW::_send() {
     // add value to message
     memcpy(&buff[4], dp->data, length);
     _rcvLen = 1;  // expected answer length is only ACK (0x00)
-    _uart->write_array(buff, 4 + length);
+    _sendDuration = (4 + length) * KW_BYTE_TIME_US / 1000;
+    _sendRequest(buff, 4 + length);
   } else {
     // type is READ
     // has fixed length of 4 chars
@@ -138,28 +160,53 @@ void OptolinkKW::_send() {
     buff[2] = address & 0xFF;
     buff[3] = length;
     _rcvLen = length;  // expected answer length is requested length
-    _uart->write_array(buff, 4);
+    _sendDuration = 4 * KW_BYTE_TIME_US / 1000;
+    _sendRequest(buff, 4);
   }
   _rcvBufferLen = 0;
-  _lastMillis = millis();
+  _lastMillis = _millis();
+  _sendMillis = _lastMillis;
   _state = RECEIVE;
 }
 
 void OptolinkKW::_receive() {
-  while (_uart->available() != 0) {  // read complete RX buffer
-    _rcvBuffer[_rcvBufferLen] = _uart->read();
+  // without a checksum, a byte left over from the last answer would shift
+  // all following answers. It can't be the answer while the request is
+  // still on the line.
+  if (_rcvBufferLen == 0 && _millis() - _sendMillis < _sendDuration) {
+    _drainInput();
+    return;
+  }
+  // read up to the expected length, a following sync is left for IDLE
+  while (_transport->available() != 0 && _rcvBufferLen < _rcvLen) {
+    _rcvBuffer[_rcvBufferLen] = _readByte();
     ++_rcvBufferLen;
-    _lastMillis = millis();
+    _lastMillis = _millis();
   }
   if (_rcvBufferLen == _rcvLen) {  // message complete, TODO: check message (eg 0x00 for READ messages)   
     OptolinkDP* dp = _queue.front();
-    ESP_LOGD(TAG, "Adding data to datapoint with address %x and received length %d", dp->address, _rcvBufferLen);
-    _tryOnData(_rcvBuffer, _rcvBufferLen);
+    ESP_LOGD(TAG, "Adding data to datapoint with address %x and received length %u", dp->address,
+             (unsigned) _rcvBufferLen);
+    if (!dp->write) {
+      _tryOnChunk(_rcvBuffer, _rcvBufferLen);
+    } else if (_rcvBuffer[0] == 0x00) {
+      // message is from WRITE command, so returning written value
+      _tryOnChunk(dp->data, dp->length);
+    } else {
+      _tryOnError(NACK);
+    }
     _state = IDLE;
-    _lastMillis = millis();
+    _lastMillis = _millis();
+    if (_queue.size() > 0) {
+      // send the next request (or chunk) within the direct send window,
+      // the next loop() might come too late for it
+      _state = SEND;
+      _send();
+    }
     return;
-  } else if (millis() - _lastMillis > 1 * 1000UL) {  // Vitotronic isn't answering, try again
-    ESP_LOGD(TAG, "Received length %d doesn't match expected length %d", _rcvBufferLen, _rcvLen);
+  } else if (_millis() - _lastMillis > KW_RESPONSE_TIMEOUT_MS) {  // Vitotronic isn't answering, try again
+    ESP_LOGD(TAG, "Received length %u doesn't match expected length %u", (unsigned) _rcvBufferLen,
+             (unsigned) _rcvLen);
     _rcvBufferLen = 0;
     memset(_rcvBuffer, 0, 4);
     _state = INIT;
@@ -49,14 +49,15 @@ class OptolinkKW : public Optolink {
   /**
    * @brief Construct the Optolink object (KW)
    * 
-   * @param uart UARTDevice object to be used. Pass by reference.
+   * @param transport Serial connection to the Vitotronic.
+   * @param clock Time source for the timeouts.
    */
-  explicit OptolinkKW(uart::UARTDevice* uart);
+  OptolinkKW(OptolinkTransport* transport, OptolinkClock* clock);
 
   /**
    * @brief Method to start the Optolink.
    * 
-   * Calling this method starts the UARTDevice (passed in the constructor)
+   * Calling this method starts the transport (passed in the constructor)
    * with the right settings.
    */
   void begin();
@@ -65,7 +66,7 @@ class OptolinkKW : public Optolink {
    * @brief Method to keep the Optolink running.
    * 
    * This method has to be called frequently. The Optolink object works by 
-   * polling the UARTDevice. If applicable, add a delay between calls to 
+   * polling the transport. If applicable, add a delay between calls to 
    * feed a watchdog (needed for ESP8266 and ESP32).
    */
   void loop();
@@ -79,6 +80,7 @@ class OptolinkKW : public Optolink {
     RECEIVE,
     UNDEF
   } _state;
+  uint8_t _traceState() const override { return _state; }
   void _init();
   void _idle();
   void _sync();
@@ -89,6 +91,8 @@ class OptolinkKW : public Optolink {
   uint8_t _rcvBuffer[MAX_DP_LENGTH];
   size_t _rcvBufferLen;
   size_t _rcvLen;
+  uint32_t _sendMillis;
+  uint32_t _sendDuration;  // ms until the request is out
 };
 
 }  // namespace vitoconnect
@@ -25,11 +25,32 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "vitoconnect_optolinkP300.h"
 
+#include "esphome/core/log.h"
+
 namespace esphome {
 namespace vitoconnect {
 
 static const char *TAG = "vitoconnect";
 
+// Timings for P300 / 4800 baud 8E2:
+// - One byte takes 12 bits on the wire.
+static constexpr uint32_t P300_BYTE_TIME_US = 12 * 1000000UL / 4800;
+// - The Vitotronic starts answering a frame within this time.
+static constexpr uint32_t P300_RESPONSE_LATENCY_MS = 500UL;
+// - Reset (0x04) is repeated until the Vitotronic sends its enquiry (0x05).
+static constexpr uint32_t P300_RESET_RETRY_MS = 1000UL;
+// - Init (0x16 0x00 0x00) and request frames are acknowledged with 0x06.
+static constexpr uint32_t P300_ACK_TIMEOUT_MS = P300_RESPONSE_LATENCY_MS;
+// - Init is repeated while idle to keep the connection alive.
+static constexpr uint32_t P300_KEEPALIVE_MS = 5000UL;
+// - Last resort if a request doesn't finish at all.
+static constexpr uint32_t P300_REQUEST_TIMEOUT_MS = 5000UL;
+
+// Time to receive an answer of (length) bytes
+inline uint32_t frameTimeout(uint8_t length) {
+  return P300_RESPONSE_LATENCY_MS + (length * P300_BYTE_TIME_US + 999) / 1000;
+}
+
 inline uint8_t calcChecksum(uint8_t array[], uint8_t length) {
   uint8_t sum = 0;
   for (uint8_t i = 1; i < length - 1; ++i) {  // start with second byte and end before checksum
@@ -42,8 +63,8 @@ inline bool checkChecksum(uint8_t array[], uint8_t length) {
   return (array[length - 1] == calcChecksum(array, length));
 }
 
-OptolinkP300::OptolinkP300(uart::UARTDevice* uart) :
-  Optolink(uart),
+OptolinkP300::OptolinkP300(OptolinkTransport* transport, OptolinkClock* clock) :
+  Optolink(transport, clock),
   _state(UNDEF),
   _lastMillis(0),
   _write(false),
@@ -88,29 +109,31 @@ void OptolinkP300::loop() {
     // begin() not called
     break;
   }
-  if (_queue.size() > 0 && millis() - _lastMillis > 5000UL) {  // if no ACK is coming, reset connection
+  if (_requestStuck(P300_REQUEST_TIMEOUT_MS)) {  // request doesn't finish, reset connection
     _tryOnError(TIMEOUT);
     _state = RESET;
-    _uart->flush();
+    _drainInput();
   }
   // TODO(@bertmelis): move timeouts here, clear queue on timeout
 }
 
 void OptolinkP300::_reset() {
-  // Set communication with Vitotronic to defined state = reset to KW protocol
+  // Set communication with Vitotronic to defined state = reset to KW protocol.
+  // Leftovers of a broken frame could be taken for the enquiry.
+  _drainInput();
   const uint8_t buff[] = {0x04};
-  _uart->write_array(buff, sizeof(buff));
-  _lastMillis = millis();
+  _writeBytes(buff, sizeof(buff));
+  _lastMillis = _millis();
   _state = RESET_ACK;
 }
 
 void OptolinkP300::_resetAck() {
-  if (_uart->read() == 0x05) {
+  if (_transport->available() && _readByte() == 0x05) {
     // received 0x05/enquiry: optolink has been reset
-    _lastMillis = millis();
+    _lastMillis = _millis();
     _state = INIT;
   } else {
-    if (millis() - _lastMillis > 1000) {  // try again every 0,5sec
+    if (_millis() - _lastMillis > P300_RESET_RETRY_MS) {  // try again
       _state = RESET;
     }
   }
@@ -118,24 +141,29 @@ void OptolinkP300::_resetAck() {
 
 void OptolinkP300::_init() {
   const uint8_t buff[] = {0x16, 0x00, 0x00};
-  _uart->write_array(buff, sizeof(buff));
-  _lastMillis = millis();
+  _writeBytes(buff, sizeof(buff));
+  _lastMillis = _millis();
   _state = INIT_ACK;
 }
 
 void OptolinkP300::_initAck() {
-  if (_uart->available()) {
-    if (_uart->read() == 0x06) {
+  if (_transport->available()) {
+    if (_readByte() == 0x06) {
       // ACK received, moving to next state
-      _lastMillis = millis();
+      _lastMillis = _millis();
       _state = IDLE;
+      return;
     }
   }
+  if (_millis() - _lastMillis > P300_ACK_TIMEOUT_MS) {
+    // no answer to init, also when nothing is queued
+    _state = RESET;
+  }
 }
 
 void OptolinkP300::_idle() {
   // send INIT every 5 seconds to keep communication alive
-  if (millis() - _lastMillis > 5 * 1000UL) {
+  if (_millis() - _lastMillis > P300_KEEPALIVE_MS) {
     _state = INIT;
   }
   if (_queue.size() > 0) {
@@ -146,8 +174,8 @@ void OptolinkP300::_idle() {
 void OptolinkP300::_send() {
   uint8_t buff[MAX_DP_LENGTH + 8];
   OptolinkDP* dp = _queue.front();
-  uint8_t length = dp->length;
-  uint16_t address = dp->address;
+  uint8_t length = _chunkLength();
+  uint16_t address = _chunkAddress();
   if (dp->write) {
     // type is WRITE, has length of 8 chars + length of value
     buff[0] = 0x41;
@@ -160,7 +188,7 @@ void OptolinkP300::_send() {
     // add value to message
     memcpy(&buff[7], dp->data, length);
     buff[7 + length] = calcChecksum(buff, 8 + length);
-    _uart->write_array(buff, 8 + length);
+    _sendRequest(buff, 8 + length);
     _rcvLen = 8;  // Written payload is not returned, the return length is
                   // always 8 bytes long
   } else {
@@ -175,16 +203,16 @@ void OptolinkP300::_send() {
     buff[6] = length;
     buff[7] = calcChecksum(buff, 8);
     _rcvLen = 8 + length;  // expected answer length is 8 + data length
-    _uart->write_array(buff, 8);
+    _sendRequest(buff, 8);
   }
   _rcvBufferLen = 0;
-  _lastMillis = millis();
+  _lastMillis = _millis();
   _state = SEND_ACK;
 }
 
 void OptolinkP300::_sentAck() {
-  if (_uart->available()) {
-    uint8_t buff = _uart->read();
+  if (_transport->available()) {
+    uint8_t buff = _readByte();
     if (buff == 0x06) {  // transmit successful, moving to next state
       _state = RECEIVE;
       return;
@@ -195,58 +223,103 @@ void OptolinkP300::_sentAck() {
       return;
     }
   }
+  if (_millis() - _lastMillis > P300_ACK_TIMEOUT_MS) {
+    // frame got lost, resynchronise
+    _tryOnError(TIMEOUT);
+    _state = RESET;
+  }
 }
 
 void OptolinkP300::_receive() {
-  while (_uart->available() != 0) {  // read complete RX buffer
-    _rcvBuffer[_rcvBufferLen] = _uart->read();
+  // read up to the end of the frame, its length follows the start byte
+  while (_transport->available() != 0 && _rcvBufferLen < _frameLength()) {
+    uint8_t data = _readByte();
+    if (_rcvBufferLen == 0 && data != 0x41) {
+      // line noise before the start byte, doesn't count as an answer
+      continue;
+    }
+    if (_rcvBufferLen == 1 && data + 3U > sizeof(_rcvBuffer)) {
+      // no answer is that long, wait for the next start byte
+      _rcvBufferLen = 0;
+      continue;
+    }
+    _rcvBuffer[_rcvBufferLen] = data;
     ++_rcvBufferLen;
-    _lastMillis = millis();
+    _lastMillis = _millis();
   }
-  if (_rcvBuffer[0] != 0x41) {
-    // wait for start byte
+  if (_millis() - _lastMillis > frameTimeout(_rcvLen)) {
+    // answer incomplete or missing
+    _tryOnError(TIMEOUT);
+    _state = RESET;
     return;
   }
-  // ESP_LOGD(TAG, "buffer fill: %02x", _rcvBuffer[_rcvBufferLen-1]);
-  // ESP_LOGD(TAG, "buffer fill: %d", _rcvBufferLen);
-  // ESP_LOGD(TAG, "buffer fill: %d", _rcvLen);
-  if (_rcvBufferLen == _rcvLen) {     // message complete, check message
-    if (_rcvBuffer[1] != (_rcvLen - 3)) {  // check for message length
-      _tryOnError(LENGTH);
-      _state = RECEIVE_ACK;
-      return;
-    }
-    if (_rcvBuffer[2] != 0x01) {  // Vitotronic returns an error message
-      _tryOnError(VITO_ERROR);
-      _state = RECEIVE_ACK;
-      return;
-    }
-    if (!checkChecksum(_rcvBuffer, _rcvLen)) {  // checksum is wrong
-      _tryOnError(CRC);
-      _state = RECEIVE_ACK;  // TODO(@bertmelis): should we return NACK?
-      return;
-    }
-    OptolinkDP* dp = _queue.front();
-    if (_rcvBuffer[3] == 0x01) {
-      // message is from READ command, so returning read value
-      _tryOnData(&_rcvBuffer[7], dp->length);
-    } else if (_rcvBuffer[3] == 0x03) {
-      // message is from WRITE command, so returning written value
-      _tryOnData(dp->data, dp->length);
-    } else {
-      // should not be here
-    }
+  if (_rcvBufferLen < 2 || _rcvBufferLen < _frameLength()) {
+    // not yet complete
+    return;
+  }
+  size_t frameLength = _frameLength();
+  if (!checkChecksum(_rcvBuffer, frameLength)) {  // checksum is wrong
+    // which request it answers is unknown, so it isn't acknowledged
+    _tryOnError(CRC);
+    const uint8_t buff[] = {0x15};
+    _writeBytes(buff, sizeof(buff));
+    _lastMillis = _millis();
+    _state = IDLE;
+    return;
+  }
+  if (frameLength >= 8 && !_matchesRequest()) {
+    // eg. a late answer or error to a request that timed out: acknowledge
+    // and drop it, the answer to the current request may still follow
+    ESP_LOGD(TAG, "Discarding answer for address %02x%02x", _rcvBuffer[4], _rcvBuffer[5]);
+    ++_stats.discarded;
+    const uint8_t buff[] = {0x06};
+    _writeBytes(buff, sizeof(buff));
+    _rcvBufferLen = 0;
+    return;
+  }
+  if (_rcvBuffer[2] != 0x01) {  // Vitotronic returns an error message
+    _tryOnError(VITO_ERROR);
     _state = RECEIVE_ACK;
     return;
+  }
+  if (frameLength < 8) {  // too short to be an answer
+    _tryOnError(LENGTH);
+    _state = RECEIVE_ACK;
+    return;
+  }
+  if (frameLength != _rcvLen) {  // check for message length
+    _tryOnError(LENGTH);
+    _state = RECEIVE_ACK;
+    return;
+  }
+  if (_rcvBuffer[3] == 0x01) {
+    // message is from READ command, so returning read value
+    _tryOnChunk(&_rcvBuffer[7], _chunkLength());
   } else {
-    // not yet complete
+    // message is from WRITE command, so returning written value
+    OptolinkDP* dp = _queue.front();
+    _tryOnChunk(dp->data, dp->length);
   }
+  _state = RECEIVE_ACK;
+}
+
+size_t OptolinkP300::_frameLength() const {
+  // start byte, length byte and checksum are not counted in the length byte
+  return (_rcvBufferLen < 2) ? 2 : _rcvBuffer[1] + 3;
+}
+
+bool OptolinkP300::_matchesRequest() {
+  OptolinkDP* dp = _queue.front();
+  uint16_t address = (_rcvBuffer[4] << 8) | _rcvBuffer[5];
+  return _rcvBuffer[3] == (dp->write ? 0x02 : 0x01) &&
+         address == _chunkAddress() &&
+         _rcvBuffer[6] == _chunkLength();
 }
 
 void OptolinkP300::_receiveAck() {
   const uint8_t buff[] = {0x06};
-  _uart->write_array(buff, sizeof(buff));
-  _lastMillis = millis();
+  _writeBytes(buff, sizeof(buff));
+  _lastMillis = _millis();
   _state = IDLE;
 }
 
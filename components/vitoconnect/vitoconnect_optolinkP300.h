@@ -49,14 +49,15 @@ class OptolinkP300 : public Optolink {
   /**
    * @brief Construct the Optolink object (P300)
    * 
-   * @param uart UARTDevice object to be used. Pass by reference.
+   * @param transport Serial connection to the Vitotronic.
+   * @param clock Time source for the timeouts.
    */
-  explicit OptolinkP300(uart::UARTDevice* uart);
+  OptolinkP300(OptolinkTransport* transport, OptolinkClock* clock);
 
   /**
    * @brief Method to start the Optolink.
    * 
-   * Calling this method starts the UARTDevice (passed in the constructor)
+   * Calling this method starts the transport (passed in the constructor)
    * with the right settings.
    */
   void begin();
@@ -65,7 +66,7 @@ class OptolinkP300 : public Optolink {
    * @brief Method to keep the Optolink running.
    * 
    * This method has to be called frequently. The Optolink object works by 
-   * polling the UARTDevice. If applicable, add a delay between calls to 
+   * polling the transport. If applicable, add a delay between calls to 
    * feed a watchdog (needed for ESP8266 and ESP32).
    */
   void loop();
@@ -83,6 +84,7 @@ class OptolinkP300 : public Optolink {
     RECEIVE_ACK,
     UNDEF
   } _state;
+  uint8_t _traceState() const override { return _state; }
   void _reset();
   void _resetAck();
   void _init();
@@ -92,6 +94,10 @@ class OptolinkP300 : public Optolink {
   void _sentAck();
   void _receive();
   void _receiveAck();
+  // Length of the frame being received, as far as known yet
+  size_t _frameLength() const;
+  // Received answer is for the front request (function, address and length)
+  bool _matchesRequest();
   uint32_t _lastMillis;
   bool _write;
   uint8_t _rcvBuffer[MAX_DP_LENGTH + 8];
@@ -0,0 +1,71 @@
+/*
+  vitoconnect_optolinkStats.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vitoconnect_optolinkStats.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace vitoconnect {
+
+void OptolinkStats::addRtt(uint32_t ms) {
+  uint8_t bucket = 0;
+  while (bucket < RTT_BUCKETS - 1 && ms > RTT_BOUNDS[bucket]) ++bucket;
+  ++rtt[bucket];
+  if (ms > rttMax) rttMax = ms;
+}
+
+void OptolinkStats::addRecovery(uint32_t ms) {
+  ++recoveries;
+  if (ms > recoveryMax) recoveryMax = ms;
+}
+
+uint32_t OptolinkStats::rttPercentile(uint8_t percent) const {
+  uint32_t total = 0;
+  for (uint8_t i = 0; i < RTT_BUCKETS; ++i) total += rtt[i];
+  if (total == 0) return 0;
+
+  uint32_t rank = (total * percent + 99) / 100;
+  uint32_t count = 0;
+  for (uint8_t i = 0; i < RTT_BUCKETS; ++i) {
+    count += rtt[i];
+    if (count >= rank) {
+      // a bucket's upper bound, never above the slowest one seen; the
+      // last bucket is open-ended
+      return (i == RTT_BUCKETS - 1) ? rttMax : std::min<uint32_t>(RTT_BOUNDS[i], rttMax);
+    }
+  }
+  return rttMax;
+}
+
+uint32_t OptolinkStats::errorCount() const {
+  uint32_t count = 0;
+  for (uint8_t i = 0; i < OPTOLINK_ERROR_TYPES; ++i) count += errors[i];
+  return count;
+}
+
+void OptolinkStats::resetWindow() {
+  for (uint8_t i = 0; i < RTT_BUCKETS; ++i) rtt[i] = 0;
+  rttMax = 0;
+  queueHighWater = 0;
+  recoveryMax = 0;
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,70 @@
+/*
+  vitoconnect_optolinkStats.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+// Number of error types, see OptolinkError
+static const uint8_t OPTOLINK_ERROR_TYPES = 5;
+
+// Round trip times are counted in buckets up to these bounds (ms)
+static const uint8_t RTT_BUCKETS = 12;
+static const uint16_t RTT_BOUNDS[RTT_BUCKETS] = {
+  25, 50, 75, 100, 150, 200, 300, 500, 750, 1000, 2000, 5000
+};
+
+/**
+ * @brief Bus statistics of an Optolink.
+ * 
+ * Counters run since boot, the round trip histogram and high-water marks
+ * since the last resetWindow().
+ */
+struct OptolinkStats {
+  uint32_t transactions{0};   ///< completed requests
+  uint32_t errors[OPTOLINK_ERROR_TYPES]{};
+  uint32_t txBytes{0};
+  uint32_t rxBytes{0};
+  uint32_t rtt[RTT_BUCKETS]{};
+  uint32_t rttMax{0};
+  uint8_t queueHighWater{0};
+  uint32_t discarded{0};      ///< answers that didn't belong to the pending request
+  uint32_t recoveries{0};     ///< failed requests followed by a successful one
+  uint32_t recoveryMax{0};    ///< longest time from a failure to the next success (ms)
+
+  void addRtt(uint32_t ms);
+  void addRecovery(uint32_t ms);
+
+  /**
+   * @brief Round trip time below which (percent) of the requests finished.
+   * 
+   * @return Upper bound of the bucket in ms, at most rttMax, 0 if there were
+   *         no requests.
+   */
+  uint32_t rttPercentile(uint8_t percent) const;
+
+  uint32_t errorCount() const;
+  void resetWindow();
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
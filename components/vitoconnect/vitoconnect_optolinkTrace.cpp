@@ -0,0 +1,84 @@
+/*
+  vitoconnect_optolinkTrace.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vitoconnect_optolinkTrace.h"
+
+#include <string.h>  // for memcpy
+
+#include "esphome/core/log.h"
+#include "vitoconnect_codec.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+static const char *TAG = "vitoconnect";
+
+void OptolinkTrace::resize(size_t records) {
+  _records.assign(records, TraceRecord{});
+  _records.shrink_to_fit();
+  clear();
+}
+
+void OptolinkTrace::clear() {
+  _next = 0;
+  _count = 0;
+}
+
+void OptolinkTrace::add(uint32_t now, TraceDirection direction, uint8_t state, const uint8_t* data, size_t len) {
+  if (_records.empty()) return;
+
+  if (direction == TRACE_RX && _count > 0) {
+    // continue the previous record while the same answer is received
+    TraceRecord& last = _records[(_next + _records.size() - 1) % _records.size()];
+    if (last.direction == TRACE_RX && last.state == state) {
+      while (len > 0 && last.length < TRACE_RECORD_DATA) {
+        last.data[last.length++] = *data++;
+        --len;
+      }
+    }
+  }
+
+  while (len > 0) {
+    TraceRecord& record = _records[_next];
+    record.timestamp = now;
+    record.direction = direction;
+    record.state = state;
+    record.length = (len > TRACE_RECORD_DATA) ? TRACE_RECORD_DATA : len;
+    memcpy(record.data, data, record.length);
+    data += record.length;
+    len -= record.length;
+
+    _next = (_next + 1) % _records.size();
+    if (_count < _records.size()) ++_count;
+  }
+}
+
+void OptolinkTrace::dump() const {
+  static const char* DIRECTIONS[] = {"TX", "RX", "ERR"};
+  ESP_LOGI(TAG, "Optolink trace, %u records:", (unsigned) _count);
+  size_t first = (_next + _records.size() - _count) % (_records.empty() ? 1 : _records.size());
+  for (size_t i = 0; i < _count; ++i) {
+    const TraceRecord& record = _records[(first + i) % _records.size()];
+    ESP_LOGI(TAG, "  %10u %-3s state %u: %s", (unsigned) record.timestamp, DIRECTIONS[record.direction],
+             record.state, decodeRaw(record.data, record.length).c_str());
+  }
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
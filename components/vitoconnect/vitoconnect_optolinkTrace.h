@@ -0,0 +1,77 @@
+/*
+  vitoconnect_optolinkTrace.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace esphome {
+namespace vitoconnect {
+
+// Bytes stored in one trace record, longer frames take several records
+static const uint8_t TRACE_RECORD_DATA = 12;
+
+enum TraceDirection : uint8_t {
+  TRACE_TX,
+  TRACE_RX,
+  TRACE_ERROR  ///< error callback, data holds the OptolinkError
+};
+
+/**
+ * @brief Ring buffer of the last bytes on the optolink.
+ * 
+ * Recording is a copy into a preallocated record, received bytes are
+ * appended to the previous record while the engine stays in the same state.
+ * Nothing is logged until dump() is called, so protocol timing is not
+ * affected. Disabled (no memory, no cost) as long as the size is 0.
+ */
+class OptolinkTrace {
+
+ public:
+  /**
+   * @brief Allocate (records) records, clears the trace.
+   */
+  void resize(size_t records);
+  bool enabled() const { return !_records.empty(); }
+
+  void add(uint32_t now, TraceDirection direction, uint8_t state, const uint8_t* data, size_t len);
+
+  /**
+   * @brief Log all records, oldest first.
+   */
+  void dump() const;
+  void clear();
+
+ private:
+  struct TraceRecord {
+    uint32_t timestamp;
+    TraceDirection direction;
+    uint8_t state;
+    uint8_t length;
+    uint8_t data[TRACE_RECORD_DATA];
+  };
+  std::vector<TraceRecord> _records;
+  size_t _next{0};   // record to be written next
+  size_t _count{0};  // records in use
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
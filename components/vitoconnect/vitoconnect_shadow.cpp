@@ -0,0 +1,115 @@
+/*
+  vitoconnect_shadow.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vitoconnect_shadow.h"
+
+#include <string.h>  // for memcpy
+
+#include "esphome/core/log.h"
+#include "vitoconnect_codec.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+static const char *TAG = "vitoconnect";
+
+bool ShadowImage::store(uint16_t address, const uint8_t* data, uint8_t length, uint32_t now) {
+  if (length == 0) return false;
+  uint32_t end = (uint32_t) address + length;
+
+  // ranges overlapping the new one: [first, last)
+  size_t first = 0;
+  while (first < _ranges.size() && _ranges[first].end() <= address) ++first;
+  size_t last = first;
+  while (last < _ranges.size() && _ranges[last].address < end) ++last;
+
+  if (first == last) {
+    _ranges.insert(_ranges.begin() + first, Range{address, now, std::vector<uint8_t>(data, data + length)});
+    return true;
+  }
+
+  Range& range = _ranges[first];
+  if (last == first + 1 && range.address <= address && range.end() >= end) {
+    // within a known range (the usual poll, or a write to a part of a
+    // block), in place
+    uint8_t* pos = &range.data[address - range.address];
+    bool changed = memcmp(pos, data, length) != 0;
+    memcpy(pos, data, length);
+    // the range is only as new as its oldest bytes
+    if (range.address == address && range.end() == end) range.timestamp = now;
+    return changed;
+  }
+
+  // merged with the ones it overlaps into the first one, this allocates
+  // only until the ranges match the stores
+  uint32_t start = range.address < address ? range.address : address;
+  uint32_t stop = _ranges[last - 1].end() > end ? _ranges[last - 1].end() : end;
+  uint32_t timestamp = now;
+  for (size_t i = first; i < last; ++i) {
+    const Range& old = _ranges[i];
+    bool replaced = old.address >= address && old.end() <= end;
+    if (!replaced && (int32_t) (old.timestamp - timestamp) < 0) timestamp = old.timestamp;
+  }
+  range.data.insert(range.data.begin(), range.address - start, 0);
+  range.data.resize(stop - start);
+  for (size_t i = first + 1; i < last; ++i) {
+    memcpy(&range.data[_ranges[i].address - start], _ranges[i].data.data(), _ranges[i].data.size());
+  }
+  memcpy(&range.data[address - start], data, length);
+  range.address = start;
+  range.timestamp = timestamp;
+  _ranges.erase(_ranges.begin() + first + 1, _ranges.begin() + last);
+  return true;
+}
+
+bool ShadowImage::fetch(uint16_t address, uint8_t length, uint8_t* output, uint32_t* timestamp) const {
+  uint32_t cursor = address;
+  uint32_t end = (uint32_t) address + length;
+  bool first = true;
+  for (const Range& range : _ranges) {
+    if (range.end() <= cursor) continue;
+    if (range.address > cursor) return false;  // gap
+
+    uint32_t to = range.end() < end ? range.end() : end;
+    if (output) memcpy(&output[cursor - address], &range.data[cursor - range.address], to - cursor);
+    if (timestamp && (first || (int32_t) (range.timestamp - *timestamp) < 0)) *timestamp = range.timestamp;
+    first = false;
+    cursor = to;
+    if (cursor >= end) return true;
+  }
+  return false;
+}
+
+size_t ShadowImage::bytes() const {
+  size_t count = 0;
+  for (const Range& range : _ranges) count += range.data.size();
+  return count;
+}
+
+void ShadowImage::dump(uint32_t now) const {
+  ESP_LOGI(TAG, "Shadow image: %u ranges, %u bytes", (unsigned) _ranges.size(), (unsigned) bytes());
+  for (const Range& range : _ranges) {
+    ESP_LOGI(TAG, "  %04x-%04x (%us ago): %s", range.address, (unsigned) (range.end() - 1),
+             (unsigned) ((now - range.timestamp) / 1000),
+             decodeRaw(range.data.data(), (uint8_t) range.data.size()).c_str());
+  }
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,83 @@
+/*
+  vitoconnect_shadow.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Sparse copy of the device's address space.
+ * 
+ * Holds every byte read from or confirmed written to the device as a sorted
+ * list of non-overlapping ranges, each with the time it was stored. Bytes
+ * within a known range (the usual poll, a write to a part of a block) are
+ * stored in place, the range keeps the time of its oldest bytes then.
+ */
+class ShadowImage {
+
+ public:
+  /**
+   * @brief Store bytes at (address), replacing older ones.
+   * 
+   * @param address First address.
+   * @param data Bytes to store.
+   * @param length Number of bytes.
+   * @param now Current time in ms.
+   * @return true The bytes differ from the ones known before
+   */
+  bool store(uint16_t address, const uint8_t* data, uint8_t length, uint32_t now);
+
+  /**
+   * @brief Copy (length) bytes at (address) if all of them are known.
+   * 
+   * @param address First address.
+   * @param length Number of bytes.
+   * @param output Buffer of at least (length) bytes, nullptr to only check.
+   * @param timestamp Receives the time the oldest of these bytes was stored,
+   *                  nullptr if not needed.
+   * @return true All bytes are known and copied
+   * @return false Some bytes were never stored
+   */
+  bool fetch(uint16_t address, uint8_t length, uint8_t* output, uint32_t* timestamp) const;
+
+  /**
+   * @brief Log all ranges with age and content.
+   */
+  void dump(uint32_t now) const;
+
+  size_t ranges() const { return _ranges.size(); }
+  size_t bytes() const;
+
+ private:
+  struct Range {
+    uint16_t address;
+    uint32_t timestamp;
+    std::vector<uint8_t> data;
+    uint32_t end() const { return (uint32_t) address + data.size(); }
+  };
+  std::vector<Range> _ranges;  // sorted by address, not overlapping
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -136,6 +136,23 @@ class SimpleQueue {
     }
   }
 
+  /**
+   * @brief Returns a pointer to the element at the given position.
+   * 
+   * Position 0 is the first element (same as `front()`). The element stays
+   * in the queue.
+   * 
+   * @param index Position of the element, counted from the front.
+   * @return T* Pointer to the element. nullptr if index is out of range.
+   */
+  T* at(size_t index) const {
+    if (index < _count) {
+      return &_buffer[(_firstPosition + index) % _size];
+    } else {
+      return nullptr;
+    }
+  }
+
   /**
    * @brief Return the number of elements in the queue.
    * 
@@ -0,0 +1,62 @@
+/*
+  vitoconnect_transport.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file vitoconnect_transport.h
+ * @brief Byte transport and clock used by the Optolink engines
+ *
+ * The protocol engines only talk to these interfaces, so they do not depend
+ * on a specific uart implementation or time source. ESPHomeTransport 
+ * implements both for an ESPHome uart.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Serial connection to the Vitotronic (4800 baud 8E2).
+ */
+class OptolinkTransport {
+ public:
+  virtual ~OptolinkTransport() {}
+
+  virtual int available() = 0;
+  virtual uint8_t read() = 0;
+  virtual uint8_t peek() = 0;
+  virtual void write(const uint8_t* data, size_t len) = 0;
+  virtual void flush() = 0;
+};
+
+/**
+ * @brief Time source of the engines' timeouts.
+ */
+class OptolinkClock {
+ public:
+  virtual ~OptolinkClock() {}
+
+  virtual uint32_t millis() = 0;
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
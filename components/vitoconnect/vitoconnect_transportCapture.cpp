@@ -0,0 +1,97 @@
+/*
+  vitoconnect_transportCapture.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "vitoconnect_transportCapture.h"
+
+#include "esphome/core/log.h"
+
+#include "vitoconnect_codec.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+static const char *TAG = "vitoconnect";
+
+// A line is complete after this gap, longer than any gap within a frame
+static const uint32_t CAPTURE_GAP_MS = 50;
+
+uint8_t CaptureTransport::read() {
+  uint8_t data = _transport->read();
+  _add(false, data);
+  return data;
+}
+
+void CaptureTransport::write(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) _add(true, data[i]);
+  _transport->write(data, len);
+}
+
+void CaptureTransport::resize(size_t lines) {
+  _lines.assign(lines, CaptureLine{});
+  _lines.shrink_to_fit();
+  _first = 0;
+  _count = 0;
+  _line.length = 0;
+}
+
+void CaptureTransport::poll(bool idle) {
+  if (_line.length > 0 && _clock->millis() - _lastMillis > CAPTURE_GAP_MS) _endLine();
+  if (!idle) return;
+
+  while (_count > 0) {
+    const CaptureLine& line = _lines[_first];
+    ESP_LOGI(TAG, "capture %u %s %s", (unsigned) line.timestamp, line.tx ? "TX" : "RX",
+             decodeRaw(line.data, line.length).c_str());
+    _first = (_first + 1) % _lines.size();
+    --_count;
+  }
+  if (_dropped > 0) {
+    ESP_LOGW(TAG, "capture buffer full, %u lines dropped", (unsigned) _dropped);
+    _dropped = 0;
+  }
+}
+
+void CaptureTransport::_add(bool tx, uint8_t data) {
+  if (_lines.empty()) return;
+
+  uint32_t now = _clock->millis();
+  if (_line.length > 0 && (tx != _line.tx || _line.length == CAPTURE_LINE_LENGTH || now - _lastMillis > CAPTURE_GAP_MS)) {
+    _endLine();
+  }
+  if (_line.length == 0) {
+    _line.tx = tx;
+    _line.timestamp = now;
+  }
+  _line.data[_line.length++] = data;
+  _lastMillis = now;
+}
+
+void CaptureTransport::_endLine() {
+  if (_count < _lines.size()) {
+    _lines[(_first + _count) % _lines.size()] = _line;
+    ++_count;
+  } else {
+    ++_dropped;
+  }
+  _line.length = 0;
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
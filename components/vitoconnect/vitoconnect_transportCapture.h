@@ -0,0 +1,95 @@
+/*
+  vitoconnect_transportCapture.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+#include "vitoconnect_transport.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+// Bytes per logged capture line
+static const uint8_t CAPTURE_LINE_LENGTH = 16;
+// Lines kept until they can be logged between transactions
+static const uint8_t CAPTURE_BUFFER_LINES = 32;
+
+/**
+ * @brief Transport that logs all bytes passing to and from the Vitotronic.
+ * 
+ * Consecutive bytes in the same direction are collected and logged as one
+ * line "capture <ms> TX|RX <hex bytes>", the timestamp being the one of the
+ * first byte. Lines end on a change of direction, when they are full or
+ * when poll() finds them quiet, so a session can be cut from the log and
+ * fed back to an engine with its original timing.
+ *
+ * Reading and writing only copy the bytes into a ring buffer of lines,
+ * logging is left to poll() so it doesn't delay a transaction. Lines not
+ * fitting into the buffer are counted and reported instead.
+ */
+class CaptureTransport : public OptolinkTransport {
+ public:
+  CaptureTransport(OptolinkTransport* transport, OptolinkClock* clock) :
+    _transport(transport),
+    _clock(clock) {}
+
+  int available() override { return _transport->available(); }
+  uint8_t read() override;
+  uint8_t peek() override { return _transport->peek(); }
+  void write(const uint8_t* data, size_t len) override;
+  void flush() override { _transport->flush(); }
+
+  /**
+   * @brief Allocate the buffer for (lines) lines, nothing is captured before.
+   */
+  void resize(size_t lines);
+
+  /**
+   * @brief End a pending line once no bytes followed for a while, log the
+   * buffered lines if (idle).
+   * 
+   * @param idle No transaction is in progress, eg. one has just finished.
+   */
+  void poll(bool idle);
+
+ private:
+  struct CaptureLine {
+    uint32_t timestamp;
+    bool tx;
+    uint8_t length;
+    uint8_t data[CAPTURE_LINE_LENGTH];
+  };
+  void _add(bool tx, uint8_t data);
+  void _endLine();
+
+  OptolinkTransport* _transport;
+  OptolinkClock* _clock;
+  std::vector<CaptureLine> _lines;
+  size_t _first{0};    // oldest buffered line
+  size_t _count{0};    // buffered lines
+  uint32_t _dropped{0};
+  CaptureLine _line{};  // line being collected
+  uint32_t _lastMillis{0};
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,50 @@
+/*
+  vitoconnect_transportESPHome.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/components/uart/uart.h"
+
+#include "vitoconnect_transport.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Transport and clock of an ESPHome uart device.
+ */
+class ESPHomeTransport : public OptolinkTransport, public OptolinkClock {
+ public:
+  explicit ESPHomeTransport(uart::UARTDevice* uart) : _uart(uart) {}
+
+  int available() override { return _uart->available(); }
+  uint8_t read() override { return _uart->read(); }
+  uint8_t peek() override { return _uart->peek(); }
+  void write(const uint8_t* data, size_t len) override { _uart->write_array(data, len); }
+  void flush() override { _uart->flush(); }
+
+  uint32_t millis() override { return esphome::millis(); }
+
+ private:
+  uart::UARTDevice* _uart;
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
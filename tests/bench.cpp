@@ -0,0 +1,168 @@
+/*
+  bench.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file bench.cpp
+ * @brief Throughput and latency of the engines against the simulators
+ *
+ * Reads every datapoint once per sweep, the way the hub polls them, and
+ * prints one JSON object per protocol and datapoint layout. Bus times are
+ * virtual, CPU time is the host's time spent in the engine's loop().
+ *
+ *   bench [--quick]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "sim_gwg.h"
+#include "sim_kw.h"
+#include "sim_p300.h"
+#include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_optolinkKW.h"
+#include "vitoconnect_optolinkP300.h"
+
+using namespace esphome::vitoconnect;
+
+static const uint32_t SWEEPS = 3;
+static const uint32_t SWEEP_TIMEOUT_MS = 600000;
+
+struct Layout {
+  const char* name;
+  uint8_t maxLength;  // lengths cycle through 1..maxLength
+  bool scattered;     // spread over the address space instead of back to back
+};
+
+struct Result {
+  uint32_t transactions{0};
+  uint32_t errors{0};
+  uint32_t sweepMs{0};
+  uint32_t p50{0};
+  uint32_t p99{0};
+  double cpuUs{0};
+};
+
+static double cpuMicros() {
+  timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static std::vector<std::pair<uint16_t, uint8_t>> datapoints(uint16_t base, uint16_t range, uint32_t count,
+                                                            const Layout& layout) {
+  std::vector<std::pair<uint16_t, uint8_t>> result;
+  uint32_t address = base;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint8_t length = 1 + i % layout.maxLength;
+    if (layout.scattered) address = base + i * (range / count);
+    result.push_back({(uint16_t) address, length});
+    if (!layout.scattered) address += length;
+  }
+  return result;
+}
+
+static Result measure(HostLink& link, Optolink& engine, SimulatedDevice& device,
+                      const std::vector<std::pair<uint16_t, uint8_t>>& points) {
+  engine.begin();
+  // connect first
+  engine.read(points[0].first, points[0].second);
+  runUntilIdle(link, engine, device, SWEEP_TIMEOUT_MS);
+  engine.stats() = OptolinkStats();
+
+  Result result;
+  double cpu = 0;
+  uint32_t start = link.millis();
+  for (uint32_t sweep = 0; sweep < SWEEPS; ++sweep) {
+    // like the hub, requests not fitting in the queue wait for space
+    size_t next = 0;
+    while (next < points.size() || engine.queueSize() > 0) {
+      while (next < points.size() && engine.read(points[next].first, points[next].second)) ++next;
+      link.advance(1);
+      device.loop();
+      double before = cpuMicros();
+      engine.loop();
+      cpu += cpuMicros() - before;
+      if (link.millis() - start > SWEEP_TIMEOUT_MS) break;
+    }
+  }
+  const OptolinkStats& stats = engine.stats();
+  result.transactions = stats.transactions;
+  result.errors = stats.errorCount();
+  result.sweepMs = (link.millis() - start) / SWEEPS;
+  result.p50 = stats.rttPercentile(50);
+  result.p99 = stats.rttPercentile(99);
+  result.cpuUs = stats.transactions ? cpu / stats.transactions : 0;
+  return result;
+}
+
+static void report(const char* protocol, const Layout& layout, uint32_t count, const Result& result) {
+  printf("{\"protocol\":\"%s\",\"layout\":\"%s\",\"max_length\":%u,\"datapoints\":%u,"
+         "\"transactions\":%u,\"errors\":%u,\"sweep_ms\":%u,\"per_minute\":%.1f,\"rtt_p50_ms\":%u,\"rtt_p99_ms\":%u,"
+         "\"cpu_us_per_transaction\":%.2f}\n",
+         protocol, layout.name, (unsigned) layout.maxLength, (unsigned) count,
+         (unsigned) result.transactions, (unsigned) result.errors,
+         (unsigned) result.sweepMs, result.sweepMs ? count * 60000.0 / result.sweepMs : 0.0,
+         (unsigned) result.p50, (unsigned) result.p99, result.cpuUs);
+}
+
+int main(int argc, char** argv) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+  std::vector<uint32_t> counts = quick ? std::vector<uint32_t>{10, 50} : std::vector<uint32_t>{10, 50, 100, 200};
+  const Layout layouts[] = {
+    {"contiguous", 1, false},
+    {"contiguous", 4, false},
+    {"scattered", 4, true},
+  };
+
+  bool failed = false;
+  for (const Layout& layout : layouts) {
+    for (uint32_t count : counts) {
+      {
+        HostLink link;
+        SimP300 device(&link);
+        OptolinkP300 engine(&link, &link);
+        Result result = measure(link, engine, device, datapoints(0x2000, 0x4000, count, layout));
+        report("P300", layout, count, result);
+        failed |= result.transactions != count * SWEEPS || result.errors;
+      }
+      {
+        HostLink link;
+        SimKW device(&link);
+        OptolinkKW engine(&link, &link);
+        Result result = measure(link, engine, device, datapoints(0x2000, 0x4000, count, layout));
+        report("KW", layout, count, result);
+        failed |= result.transactions != count * SWEEPS || result.errors;
+      }
+      {
+        // 1 byte addresses only
+        HostLink link;
+        SimGWG device(&link);
+        OptolinkGWG engine(&link, &link);
+        Layout gwgLayout = layout;
+        if (count * gwgLayout.maxLength > 0x100) gwgLayout.maxLength = 1;
+        Result result = measure(link, engine, device, datapoints(0x0000, 0x100, count, gwgLayout));
+        report("GWG", gwgLayout, count, result);
+        failed |= result.transactions != count * SWEEPS || result.errors;
+      }
+    }
+  }
+  return failed ? 1 : 0;
+}
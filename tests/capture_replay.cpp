@@ -0,0 +1,265 @@
+/*
+  capture_replay.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "capture_replay.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+
+#include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_optolinkKW.h"
+#include "vitoconnect_optolinkP300.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+// Time given to the engine after the last captured line
+static const uint32_t REPLAY_TAIL_MS = 10000;
+
+// GWG telegram types and the function byte selecting them in an address
+struct GWGType {
+  uint8_t type;
+  uint8_t function;
+  bool write;
+};
+
+static const GWGType GWG_TYPES[] = {
+  {0xC7, 0x01, false}, {0xC4, 0x02, true},  {0xCB, 0x03, false}, {0xC8, 0x04, true},
+  {0xAE, 0x05, false}, {0xAD, 0x06, true},  {0xC5, 0x49, false}, {0xC3, 0x50, true},
+  {0x6E, 0x51, false}, {0x6D, 0x52, true},  {0x9E, 0x53, false}, {0x9D, 0x54, true},
+  {0x33, 0x65, false}, {0x43, 0x67, false},
+};
+
+bool parseCaptureLine(const std::string& text, CaptureLine* line) {
+  size_t start = text.find("capture ");
+  if (start == std::string::npos) return false;
+  const char* p = text.c_str() + start + strlen("capture ");
+
+  char* end;
+  unsigned long millis = strtoul(p, &end, 10);
+  if (end == p || *end != ' ') return false;
+  p = end + 1;
+  if (strncmp(p, "TX ", 3) == 0) {
+    line->tx = true;
+  } else if (strncmp(p, "RX ", 3) == 0) {
+    line->tx = false;
+  } else {
+    return false;
+  }
+  p += 3;
+  line->millis = millis;
+  line->data.clear();
+  // hex bytes up to the end of the line or a color code
+  while (p[0] && p[1] && isxdigit((unsigned char) p[0]) && isxdigit((unsigned char) p[1])) {
+    line->data.push_back(strtoul(std::string(p, 2).c_str(), nullptr, 16));
+    p += 2;
+    if (*p != ' ') break;
+    ++p;
+  }
+  return !line->data.empty();
+}
+
+std::vector<CaptureLine> readCapture(FILE* file) {
+  std::vector<CaptureLine> capture;
+  char buffer[512];
+  CaptureLine line;
+  while (fgets(buffer, sizeof(buffer), file)) {
+    if (parseCaptureLine(buffer, &line)) capture.push_back(line);
+  }
+  return capture;
+}
+
+std::vector<ReplayRequest> parseRequests(ReplayProtocol protocol, const std::vector<uint8_t>& tx) {
+  std::vector<ReplayRequest> requests;
+  size_t i = 0;
+  while (i < tx.size()) {
+    size_t left = tx.size() - i;
+    const uint8_t* frame = &tx[i];
+    ReplayRequest request;
+    size_t frameLength = 1;
+    bool found = false;
+    switch (protocol) {
+    case REPLAY_P300:
+      // 0x41, length, type, function, address, length, [value], checksum
+      if (frame[0] == 0x41 && left >= 8 && (frame[3] == 0x01 || frame[3] == 0x02)) {
+        frameLength = frame[1] + 3;
+        request.write = frame[3] == 0x02;
+        request.address = (frame[4] << 8) | frame[5];
+        request.length = frame[6];
+        found = frameLength <= left && (!request.write || request.length + 8U == frameLength);
+        if (found && request.write) request.value.assign(frame + 7, frame + 7 + request.length);
+      }
+      break;
+    case REPLAY_KW:
+      // 0xF7 (read) or 0xF4 (write), address, length, [value]
+      if ((frame[0] == 0xF7 || frame[0] == 0xF4) && left >= 4) {
+        request.write = frame[0] == 0xF4;
+        request.address = (frame[1] << 8) | frame[2];
+        request.length = frame[3];
+        frameLength = 4 + (request.write ? request.length : 0);
+        found = frameLength <= left;
+        if (found && request.write) request.value.assign(frame + 4, frame + 4 + request.length);
+      }
+      break;
+    default:
+      // type, address, length, 0x04, [value]
+      for (const GWGType& type : GWG_TYPES) {
+        if (frame[0] != type.type || left < 4 || frame[3] != 0x04) continue;
+        request.write = type.write;
+        request.address = (type.function << 8) | frame[1];
+        request.length = frame[2];
+        frameLength = 4 + (request.write ? request.length : 0);
+        found = frameLength <= left;
+        if (found && request.write) request.value.assign(frame + 4, frame + 4 + request.length);
+        break;
+      }
+      break;
+    }
+    if (found) {
+      requests.push_back(request);
+      i += frameLength;
+    } else {
+      // protocol bytes like reset, init or acknowledges
+      ++i;
+    }
+  }
+  return requests;
+}
+
+ReplayDevice::ReplayDevice(HostLink* link, const std::vector<CaptureLine>& capture) :
+  _link(link),
+  _capture(capture),
+  _anchorCapture(capture.empty() ? 0 : capture[0].millis),
+  _anchorLink(link->millis()) {}
+
+void ReplayDevice::loop() {
+  uint32_t now = _link->millis();
+  uint8_t data;
+  while (_link->deviceRead(&data)) {
+    if (done() || !_capture[_line].tx) {
+      ++mismatches;
+      continue;
+    }
+    const CaptureLine& line = _capture[_line];
+    if (_offset == 0) {
+      _anchorCapture = line.millis;
+      _anchorLink = now;
+    }
+    if (data != line.data[_offset]) ++mismatches;
+    if (++_offset == line.data.size()) {
+      _offset = 0;
+      ++_line;
+    }
+  }
+
+  while (!done() && !_capture[_line].tx) {
+    const CaptureLine& line = _capture[_line];
+    if (now - _anchorLink < line.millis - _anchorCapture) break;
+    _link->deviceWrite(line.data.data(), line.data.size());
+    ++_line;
+  }
+}
+
+struct ReplayContext {
+  ReplayResult* result;
+  std::vector<ReplayRequest> requests;
+};
+
+static ReplayContext* context = nullptr;
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {
+  const ReplayRequest& request = context->requests[(uintptr_t) arg];
+  context->result->values.push_back({request.address, request.write, false, std::vector<uint8_t>(data, data + len)});
+}
+
+static void onError(uint8_t error, void* arg) {
+  const ReplayRequest& request = context->requests[(uintptr_t) arg];
+  context->result->values.push_back({request.address, request.write, true, {error}});
+}
+
+ReplayResult replay(ReplayProtocol protocol, const std::vector<CaptureLine>& capture) {
+  ReplayResult result;
+  ReplayContext replayContext{&result, {}};
+  context = &replayContext;
+
+  // requests of each run of TX lines, queued once the run is due
+  std::vector<std::vector<size_t>> requestsAt(capture.size());
+  for (size_t i = 0; i < capture.size();) {
+    if (!capture[i].tx) {
+      ++i;
+      continue;
+    }
+    size_t run = i;
+    std::vector<uint8_t> tx;
+    for (; i < capture.size() && capture[i].tx; ++i) tx.insert(tx.end(), capture[i].data.begin(), capture[i].data.end());
+    for (const ReplayRequest& request : parseRequests(protocol, tx)) {
+      requestsAt[run].push_back(replayContext.requests.size());
+      replayContext.requests.push_back(request);
+    }
+  }
+
+  HostLink link;
+  ReplayDevice device(&link, capture);
+  std::unique_ptr<Optolink> engine;
+  switch (protocol) {
+  case REPLAY_P300:
+    engine.reset(new OptolinkP300(&link, &link));
+    break;
+  case REPLAY_KW:
+    engine.reset(new OptolinkKW(&link, &link));
+    break;
+  default:
+    engine.reset(new OptolinkGWG(&link, &link));
+    break;
+  }
+  engine->onData(onData);
+  engine->onError(onError);
+  engine->begin();
+
+  uint32_t duration = capture.empty() ? 0 : capture.back().millis - capture.front().millis;
+  size_t queued = 0;  // lines whose requests are queued
+  while (link.millis() < duration + REPLAY_TAIL_MS && !(device.done() && engine->queueSize() == 0)) {
+    // a request is only queued when the capture gets to it, the engine
+    // might send it differently (eg. without waiting for a sync) otherwise
+    for (; queued <= device.line() && queued < capture.size(); ++queued) {
+      for (size_t index : requestsAt[queued]) {
+        const ReplayRequest& request = replayContext.requests[index];
+        if (request.write) {
+          std::vector<uint8_t> value = request.value;
+          engine->write(request.address, request.length, value.data(), (void*) index);
+        } else {
+          engine->read(request.address, request.length, (void*) index);
+        }
+      }
+    }
+    link.advance(1);
+    device.loop();
+    engine->loop();
+  }
+
+  result.mismatches = device.mismatches;
+  result.complete = device.done() && engine->queueSize() == 0;
+  context = nullptr;
+  return result;
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,125 @@
+/*
+  capture_replay.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file capture_replay.h
+ * @brief Replay of sessions recorded with `capture: true`
+ *
+ * The Vitotronic's side of a capture is played back to an engine with its
+ * original timing, relative to the engine's requests. The requests are
+ * taken from the captured TX lines, so the engine sends the same frames
+ * again, and what it sends is compared with the capture.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "host_link.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+struct CaptureLine {
+  uint32_t millis;
+  bool tx;
+  std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Parse a "capture <ms> TX|RX <hex bytes>" line.
+ *
+ * Anything before "capture", like the logger's prefix, is skipped.
+ *
+ * @return false The line is no capture line
+ */
+bool parseCaptureLine(const std::string& text, CaptureLine* line);
+
+/**
+ * @brief Read all capture lines of a log, other lines are skipped.
+ */
+std::vector<CaptureLine> readCapture(FILE* file);
+
+enum ReplayProtocol : uint8_t { REPLAY_P300, REPLAY_KW, REPLAY_GWG };
+
+/**
+ * @brief Request as passed to Optolink::read() or write().
+ */
+struct ReplayRequest {
+  uint16_t address;
+  uint8_t length;
+  bool write;
+  std::vector<uint8_t> value;
+};
+
+/**
+ * @brief The requests in bytes sent by an engine of (protocol).
+ */
+std::vector<ReplayRequest> parseRequests(ReplayProtocol protocol, const std::vector<uint8_t>& tx);
+
+/**
+ * @brief Plays the RX lines of a capture and checks the bytes received
+ * against the TX lines.
+ *
+ * An RX line is played once all lines before it have been played or
+ * received, at its captured distance to the last TX line.
+ */
+class ReplayDevice : public SimulatedDevice {
+ public:
+  ReplayDevice(HostLink* link, const std::vector<CaptureLine>& capture);
+  void loop() override;
+
+  // next line to be played or received
+  size_t line() const { return _line; }
+  bool done() const { return _line == _capture.size(); }
+
+  uint32_t mismatches{0};  ///< bytes received differently from, or beyond, the capture
+
+ private:
+  HostLink* _link;
+  const std::vector<CaptureLine>& _capture;
+  size_t _line{0};
+  size_t _offset{0};  // within a TX line
+  uint32_t _anchorCapture;
+  uint32_t _anchorLink;
+};
+
+struct ReplayValue {
+  uint16_t address;
+  bool write;
+  bool error;
+  std::vector<uint8_t> data;
+};
+
+struct ReplayResult {
+  std::vector<ReplayValue> values;  ///< in the order of the callbacks
+  uint32_t mismatches{0};
+  bool complete{false};             ///< all lines replayed and all requests done
+};
+
+/**
+ * @brief Replay (capture) to a new engine of (protocol).
+ */
+ReplayResult replay(ReplayProtocol protocol, const std::vector<CaptureLine>& capture);
+
+}  // namespace vitoconnect
+}  // namespace esphome
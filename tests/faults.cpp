@@ -0,0 +1,274 @@
+/*
+  faults.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file faults.cpp
+ * @brief Recovery of the engines from faults on the link
+ *
+ * Polls a few datapoints continuously, injects one fault per run at
+ * different moments of the transaction and prints one JSON object per
+ * protocol and fault:
+ *
+ *   recovery_ms      from the fault to the first correct answer after the
+ *                    last failed or wrong one (mean and max over the runs)
+ *   lost_per_fault   requests ending in an error callback
+ *   wrong_values     answers delivered with values the Vitotronic didn't send
+ *
+ * Fails if a run doesn't recover or P300 delivers a wrong value.
+ */
+
+#include <stdio.h>
+#include <functional>
+#include <memory>
+
+#include "esphome/core/log.h"
+#include "sim_gwg.h"
+#include "sim_kw.h"
+#include "sim_p300.h"
+#include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_optolinkKW.h"
+#include "vitoconnect_optolinkP300.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+enum Protocol : uint8_t { P300, KW, GWG, PROTOCOLS };
+static const char* PROTOCOL_NAMES[PROTOCOLS] = {"P300", "KW", "GWG"};
+
+enum Fault : uint8_t { DROP, BIT_FLIP, STRAY_ENQ, STRAY_ACK, REBOOT, SILENCE, FAULTS };
+static const char* FAULT_NAMES[FAULTS] = {"drop", "bit_flip", "stray_0x05", "stray_0x06", "reboot", "silence"};
+
+static const uint32_t RUNS = 10;
+static const uint32_t PHASE_MS = 53;           // fault moment advances by this per run
+static const uint32_t WARMUP_MS = 3000;
+static const uint32_t RUN_MS = 30000;          // after the fault
+static const uint32_t SILENCE_MS = 10000;
+static const uint32_t RECOVERY_LIMIT_MS = 15000;  // beyond the fault itself
+
+static const uint8_t POINTS = 4;
+static const uint8_t POINT_LENGTH = 2;
+
+static uint8_t expected(uint16_t address) { return (address * 7 + 3) & 0xFF; }
+
+struct Run {
+  Protocol protocol;
+  HostLink link;
+  std::unique_ptr<SimulatedDevice> device;
+  std::unique_ptr<Optolink> engine;
+  uint16_t addresses[POINTS];
+
+  uint32_t faultAt{0};
+  bool armed{false};
+  bool rebooting{false};
+  uint32_t errors{0};
+  uint32_t wrong{0};
+  uint32_t lastBad{0};
+  bool bad{false};
+  bool recovered{false};
+  uint32_t recoveredAt{0};
+
+  explicit Run(Protocol protocol) : protocol(protocol) {
+    for (uint8_t i = 0; i < POINTS; ++i) {
+      addresses[i] = (protocol == GWG ? 0x0010 : 0x2000) + i * 0x10;
+    }
+    switch (protocol) {
+    case P300:
+      engine.reset(new OptolinkP300(&link, &link));
+      break;
+    case KW:
+      engine.reset(new OptolinkKW(&link, &link));
+      break;
+    default:
+      engine.reset(new OptolinkGWG(&link, &link));
+      break;
+    }
+    boot();
+    engine->onData(onData);
+    engine->onError(onError);
+    engine->begin();
+  }
+
+  // a freshly powered Vitotronic
+  void boot() {
+    switch (protocol) {
+    case P300: {
+      SimP300* sim = new SimP300(&link);
+      for (uint32_t i = 0; i < 0x10000; ++i) sim->memory[i] = expected(i);
+      device.reset(sim);
+      break;
+    }
+    case KW: {
+      SimKW* sim = new SimKW(&link);
+      for (uint32_t i = 0; i < 0x10000; ++i) sim->memory[i] = expected(i);
+      device.reset(sim);
+      break;
+    }
+    default: {
+      SimGWG* sim = new SimGWG(&link);
+      for (int region = 0; region < GWG_REGIONS; ++region) {
+        for (int i = 0; i < 0x100; ++i) sim->memory[region][i] = expected(i);
+      }
+      device.reset(sim);
+      break;
+    }
+    }
+  }
+
+  void inject(Fault fault, uint32_t at) {
+    faultAt = at;
+    link.filter = [this, fault](bool toDevice, uint8_t& data) {
+      uint32_t now = link.millis();
+      if (now < faultAt) return true;
+      switch (fault) {
+      case DROP:
+        if (!armed || toDevice) return true;
+        armed = false;
+        return false;
+      case BIT_FLIP:
+        if (!armed || toDevice) return true;
+        armed = false;
+        data ^= 0x08;
+        return true;
+      case REBOOT:
+        // the Vitotronic resets after the first byte of what it was sending
+        if (!armed || toDevice) return true;
+        if (rebooting) return false;
+        rebooting = true;
+        return true;
+      case SILENCE:
+        return now >= faultAt + SILENCE_MS;
+      default:
+        return true;
+      }
+    };
+  }
+
+  void step(Fault fault) {
+    link.advance(1);
+    uint32_t now = link.millis();
+    if (now == faultAt) {
+      armed = true;
+      if (fault == STRAY_ENQ || fault == STRAY_ACK) {
+        const uint8_t stray[] = {(uint8_t) (fault == STRAY_ENQ ? 0x05 : 0x06)};
+        link.deviceWrite(stray, sizeof(stray));
+      }
+    }
+    device->loop();
+    if (rebooting && armed) {
+      armed = false;
+      boot();
+    }
+    if (engine->queueSize() == 0) {
+      // poll like the hub, one group after the other
+      for (uint8_t i = 0; i < POINTS; ++i) engine->read(addresses[i], POINT_LENGTH, &addresses[i]);
+    }
+    engine->loop();
+  }
+
+  void failed(uint32_t now) {
+    if (now < faultAt) return;
+    bad = true;
+    lastBad = now;
+    recovered = false;
+  }
+
+  void answered(uint32_t now) {
+    if (now < faultAt || recovered) return;
+    recovered = true;
+    recoveredAt = now;
+  }
+
+  static Run* current;
+  static void onData(uint8_t* data, uint8_t len, void* arg) {
+    uint16_t address = *(uint16_t*) arg;
+    uint32_t now = current->link.millis();
+    for (uint8_t i = 0; i < len; ++i) {
+      if (data[i] != expected(address + i)) {
+        ++current->wrong;
+        current->failed(now);
+        return;
+      }
+    }
+    current->answered(now);
+  }
+  static void onError(uint8_t error, void* arg) {
+    uint32_t now = current->link.millis();
+    if (now >= current->faultAt) ++current->errors;
+    current->failed(now);
+  }
+};
+
+Run* Run::current = nullptr;
+
+struct Result {
+  uint32_t runs{0};
+  uint32_t recovered{0};
+  uint64_t recoverySum{0};
+  uint32_t recoveryMax{0};
+  uint32_t errors{0};
+  uint32_t wrong{0};
+  uint32_t engineRecoveryMax{0};
+};
+
+static Result measure(Protocol protocol, Fault fault) {
+  Result result;
+  for (uint32_t i = 0; i < RUNS; ++i) {
+    Run run(protocol);
+    Run::current = &run;
+    uint32_t faultAt = WARMUP_MS + i * PHASE_MS;
+    run.inject(fault, faultAt);
+    while (run.link.millis() < faultAt + RUN_MS) run.step(fault);
+    Run::current = nullptr;
+
+    ++result.runs;
+    result.errors += run.errors;
+    result.wrong += run.wrong;
+    if (run.engine->stats().recoveryMax > result.engineRecoveryMax) {
+      result.engineRecoveryMax = run.engine->stats().recoveryMax;
+    }
+    if (!run.recovered) continue;
+    ++result.recovered;
+    uint32_t recovery = run.recoveredAt - faultAt;
+    result.recoverySum += recovery;
+    if (recovery > result.recoveryMax) result.recoveryMax = recovery;
+  }
+  return result;
+}
+
+int main() {
+  esphome::host_log_level(ESPHOME_LOG_LEVEL_NONE);
+  for (uint8_t protocol = 0; protocol < PROTOCOLS; ++protocol) {
+    for (uint8_t fault = 0; fault < FAULTS; ++fault) {
+      Result result = measure((Protocol) protocol, (Fault) fault);
+      printf("{\"protocol\":\"%s\",\"fault\":\"%s\",\"runs\":%u,\"recovered\":%u,\"recovery_ms_mean\":%u,"
+             "\"recovery_ms_max\":%u,\"lost_per_fault\":%.1f,\"wrong_values\":%u,\"recovery_time_max\":%u}\n",
+             PROTOCOL_NAMES[protocol], FAULT_NAMES[fault], (unsigned) result.runs, (unsigned) result.recovered,
+             (unsigned) (result.recovered ? result.recoverySum / result.recovered : 0),
+             (unsigned) result.recoveryMax, (double) result.errors / result.runs, (unsigned) result.wrong,
+             (unsigned) result.engineRecoveryMax);
+
+      CHECK_EQ(result.recovered, result.runs);
+      uint32_t limit = RECOVERY_LIMIT_MS + (fault == SILENCE ? SILENCE_MS : 0);
+      CHECK(result.recoveryMax < limit);
+      // the checksum catches everything we inject
+      if (protocol == P300) CHECK_EQ(result.wrong, 0);
+    }
+  }
+  return testResult();
+}
@@ -0,0 +1,248 @@
+/*
+  fuzz_receive.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file fuzz_receive.cpp
+ * @brief Fuzz target for the engines' receive paths
+ *
+ * The input is a program of requests, raw bytes put on the line and time
+ * steps, optionally next to a simulated Vitotronic so that the engine also
+ * gets into its deeper states. Every request must end in exactly one data
+ * or error callback, in order, and none may hang longer than the
+ * watchdog allows. Out of bounds accesses are left to the sanitizers.
+ *
+ * Built for libFuzzer when the compiler supports it, otherwise main()
+ * runs a fixed number of random programs and the files given as arguments.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "esphome/core/log.h"
+#include "sim_gwg.h"
+#include "sim_kw.h"
+#include "sim_p300.h"
+#include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_optolinkKW.h"
+#include "vitoconnect_optolinkP300.h"
+
+using namespace esphome::vitoconnect;
+
+#ifndef FUZZ_PROTOCOL
+#define FUZZ_PROTOCOL 0  // 0: P300, 1: KW, 2: GWG
+#endif
+
+// All engines give up a request (or chunk) without progress after 5 s
+static const uint32_t WATCHDOG_MS = 5000;
+static const uint32_t WATCHDOG_SLACK_MS = 100;
+static const uint8_t MAX_FUZZ_LENGTH = 32;
+
+class NoDevice : public SimulatedDevice {
+ public:
+  void loop() override {}
+};
+
+struct Request {
+  uintptr_t id;
+  uint8_t length;
+};
+
+static std::deque<Request> pending;
+static uint32_t lastProgress = 0;
+static HostLink* currentLink = nullptr;
+
+static void fail(const char* message) {
+  fprintf(stderr, "fuzz: %s\n", message);
+  abort();
+}
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {
+  if (pending.empty() || pending.front().id != (uintptr_t) arg) fail("data callback for another request");
+  if (len != pending.front().length) fail("data callback with wrong length");
+  volatile uint8_t sum = 0;
+  for (uint8_t i = 0; i < len; ++i) sum += data[i];  // all bytes readable
+  pending.pop_front();
+  lastProgress = currentLink->millis();
+}
+
+static void onError(uint8_t error, void* arg) {
+  if (pending.empty() || pending.front().id != (uintptr_t) arg) fail("error callback for another request");
+  if (error > VITO_ERROR) fail("unknown error");
+  pending.pop_front();
+  lastProgress = currentLink->millis();
+}
+
+static uint32_t allowedGap() {
+  uint8_t length = pending.empty() ? 1 : pending.front().length;
+  uint32_t chunks = (length + MAX_DP_LENGTH - 1) / MAX_DP_LENGTH;
+  return chunks * (WATCHDOG_MS + WATCHDOG_SLACK_MS);
+}
+
+static void step(HostLink& link, Optolink& engine, SimulatedDevice& device) {
+  link.advance(1);
+  device.loop();
+  engine.loop();
+  if (pending.empty()) {
+    lastProgress = link.millis();
+  } else if (link.millis() - lastProgress > allowedGap()) {
+    fail("request stuck beyond the watchdog");
+  }
+}
+
+static void fuzzOne(const uint8_t* data, size_t size) {
+  if (size == 0) return;
+  esphome::host_log_level(ESPHOME_LOG_LEVEL_NONE);
+  HostLink link;
+  currentLink = &link;
+  pending.clear();
+  lastProgress = 0;
+
+  std::unique_ptr<Optolink> engine;
+  std::unique_ptr<SimulatedDevice> device;
+  bool simulated = data[0] & 0x01;
+  uint16_t addressMask = 0xFFFF;
+  switch (FUZZ_PROTOCOL) {
+  case 0:
+    engine.reset(new OptolinkP300(&link, &link));
+    if (simulated) device.reset(new SimP300(&link));
+    break;
+  case 1:
+    engine.reset(new OptolinkKW(&link, &link));
+    if (simulated) device.reset(new SimKW(&link));
+    break;
+  default:
+    // requests the engine drops without callback are not generated
+    engine.reset(new OptolinkGWG(&link, &link));
+    if (simulated) device.reset(new SimGWG(&link));
+    addressMask = 0x00DF;
+    break;
+  }
+  if (!device) device.reset(new NoDevice());
+  engine->onData(onData);
+  engine->onError(onError);
+  engine->begin();
+
+  uintptr_t nextId = 1;
+  size_t pos = 1;
+  auto next = [&]() -> uint8_t { return pos < size ? data[pos++] : 0; };
+  auto nextAddress = [&]() -> uint16_t {
+    uint16_t high = next();
+    return ((high << 8) | next()) & addressMask;
+  };
+  while (pos < size) {
+    uint8_t op = next();
+    uint8_t arg = op & 0x3F;
+    switch (op >> 6) {
+    case 0: {
+      // read
+      uint16_t address = nextAddress();
+      uint8_t length = 1 + arg % MAX_FUZZ_LENGTH;
+      if (engine->read(address, length, (void*) nextId)) pending.push_back({nextId, length});
+      ++nextId;
+      break;
+    }
+    case 1: {
+      // write
+      uint16_t address = nextAddress();
+      uint8_t length = 1 + arg % MAX_DP_LENGTH;
+      uint8_t value[MAX_DP_LENGTH];
+      for (uint8_t i = 0; i < length; ++i) value[i] = next();
+      if (engine->write(address, length, value, (void*) nextId)) pending.push_back({nextId, length});
+      ++nextId;
+      break;
+    }
+    case 2: {
+      // raw bytes from the Vitotronic's side
+      uint8_t bytes[64];
+      uint8_t count = 0;
+      for (; count <= arg && pos < size; ++count) bytes[count] = next();
+      link.deviceWrite(bytes, count);
+      break;
+    }
+    default:
+      // time passes
+      for (uint32_t ms = 0; ms < (arg + 1) * 10U; ++ms) step(link, *engine, *device);
+      break;
+    }
+  }
+
+  // everything has to end, one way or the other
+  uint32_t limit = (pending.size() + 1) * (MAX_FUZZ_LENGTH / MAX_DP_LENGTH + 1) * (WATCHDOG_MS + WATCHDOG_SLACK_MS);
+  for (uint32_t ms = 0; ms < limit && !pending.empty(); ++ms) step(link, *engine, *device);
+  if (!pending.empty() || engine->queueSize() != 0) fail("requests left without callback");
+  currentLink = nullptr;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  fuzzOne(data, size);
+  return 0;
+}
+
+#ifndef VITOCONNECT_LIBFUZZER
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    FILE* file = fopen(argv[i], "rb");
+    if (!file) {
+      fprintf(stderr, "fuzz: cannot open %s\n", argv[i]);
+      return 1;
+    }
+    std::vector<uint8_t> input;
+    int c;
+    while ((c = fgetc(file)) != EOF) input.push_back(c);
+    fclose(file);
+    fuzzOne(input.data(), input.size());
+  }
+  if (argc > 1) return 0;
+
+  // random programs of valid operations, reproducible
+  static const uint8_t INTERESTING[] = {0x00, 0x01, 0x04, 0x05, 0x06, 0x15, 0x16, 0x41, 0xFF};
+  std::mt19937 random(FUZZ_PROTOCOL + 1);
+  for (int run = 0; run < 1000; ++run) {
+    std::vector<uint8_t> input = {(uint8_t) random()};
+    for (int ops = random() % 60; ops > 0; --ops) {
+      uint8_t count = random() % 64;
+      switch (random() % 4) {
+      case 0:
+        input.insert(input.end(), {(uint8_t) (random() % 64), (uint8_t) random(), (uint8_t) random()});
+        break;
+      case 1:
+        input.insert(input.end(), {(uint8_t) (0x40 | random() % 64), (uint8_t) random(), (uint8_t) random()});
+        for (int i = 0; i < MAX_DP_LENGTH; ++i) input.push_back(random());
+        break;
+      case 2:
+        input.push_back(0x80 | count);
+        for (int i = 0; i <= count; ++i) {
+          input.push_back(random() % 2 ? INTERESTING[random() % sizeof(INTERESTING)] : random());
+        }
+        break;
+      default:
+        input.push_back(0xC0 | random() % 8);
+        break;
+      }
+    }
+    fuzzOne(input.data(), input.size());
+  }
+  return 0;
+}
+#endif
@@ -0,0 +1,58 @@
+/*
+  host_hub.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "host_hub.h"
+
+namespace esphome {
+
+static vitoconnect::HostLink* hubLink = nullptr;
+
+uint32_t millis() { return hubLink ? hubLink->millis() : 0; }
+uint32_t micros() { return hubLink ? hubLink->micros() : 0; }
+
+namespace vitoconnect {
+
+bool HostUART::read_array(uint8_t* data, size_t len) {
+  if ((size_t) _link->available() < len) return false;
+  for (size_t i = 0; i < len; ++i) data[i] = _link->read();
+  return true;
+}
+
+bool HostUART::peek_byte(uint8_t* data) {
+  if (_link->available() == 0) return false;
+  *data = _link->peek();
+  return true;
+}
+
+void hostHubLink(HostLink* link) {
+  hubLink = link;
+}
+
+void runHub(HostLink& link, VitoConnect& hub, SimulatedDevice& device, uint32_t ms) {
+  uint32_t interval = hub.get_update_interval();
+  for (uint32_t i = 0; i < ms; ++i) {
+    link.advance(1);
+    device.loop();
+    hub.loop();
+    if (interval && link.millis() % interval == 0) hub.update();
+  }
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,63 @@
+/*
+  host_hub.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file host_hub.h
+ * @brief The VitoConnect hub on a HostLink
+ *
+ * HostUART is the hub's uart bus, esphome::millis() and micros() follow
+ * the link's virtual time.
+ */
+
+#pragma once
+
+#include "esphome/components/uart/uart_component.h"
+#include "host_link.h"
+#include "vitoconnect.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+class HostUART : public uart::UARTComponent {
+ public:
+  explicit HostUART(HostLink* link) : _link(link) {}
+
+  int available() override { return _link->available(); }
+  bool read_array(uint8_t* data, size_t len) override;
+  bool peek_byte(uint8_t* data) override;
+  void write_array(const uint8_t* data, size_t len) override { _link->write(data, len); }
+  void flush() override {}
+
+ private:
+  HostLink* _link;
+};
+
+/**
+ * @brief Time source of esphome::millis() and micros().
+ */
+void hostHubLink(HostLink* link);
+
+/**
+ * @brief Run hub and device for (ms) milliseconds in 1 ms steps, calling
+ * update() every update interval like ESPHome.
+ */
+void runHub(HostLink& link, VitoConnect& hub, SimulatedDevice& device, uint32_t ms);
+
+}  // namespace vitoconnect
+}  // namespace esphome
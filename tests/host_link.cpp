@@ -0,0 +1,90 @@
+/*
+  host_link.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "host_link.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+int HostLink::available() {
+  int count = 0;
+  for (const Byte& byte : _toEngine) {
+    if (byte.arrival > _nowUs) break;
+    ++count;
+  }
+  return count;
+}
+
+uint8_t HostLink::read() {
+  if (available() == 0) return 0xFF;  // like an idle line
+  uint8_t data = _toEngine.front().data;
+  _toEngine.pop_front();
+  return data;
+}
+
+uint8_t HostLink::peek() {
+  if (available() == 0) return 0xFF;
+  return _toEngine.front().data;
+}
+
+void HostLink::write(const uint8_t* data, size_t len) {
+  _send(_toDevice, _toDeviceBusy, true, data, len);
+}
+
+void HostLink::deviceWrite(const uint8_t* data, size_t len) {
+  _send(_toEngine, _toEngineBusy, false, data, len);
+}
+
+bool HostLink::deviceRead(uint8_t* data) {
+  if (_toDevice.empty() || _toDevice.front().arrival > _nowUs) return false;
+  *data = _toDevice.front().data;
+  _toDevice.pop_front();
+  return true;
+}
+
+void HostLink::_send(std::deque<Byte>& line, uint64_t& busyUntil, bool toDevice, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    // a byte starts once the previous one is out
+    uint64_t start = busyUntil > _nowUs ? busyUntil : _nowUs;
+    busyUntil = start + HOST_BYTE_TIME_US;
+    uint8_t byte = data[i];
+    if (filter && !filter(toDevice, byte)) continue;
+    line.push_back(Byte{busyUntil, byte});
+  }
+}
+
+void runFor(HostLink& link, Optolink& engine, SimulatedDevice& device, uint32_t ms) {
+  for (uint32_t i = 0; i < ms; ++i) {
+    link.advance(1);
+    device.loop();
+    engine.loop();
+  }
+}
+
+bool runUntilIdle(HostLink& link, Optolink& engine, SimulatedDevice& device, uint32_t ms) {
+  for (uint32_t i = 0; i < ms && engine.queueSize() > 0; ++i) {
+    link.advance(1);
+    device.loop();
+    engine.loop();
+  }
+  return engine.queueSize() == 0;
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
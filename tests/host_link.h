@@ -0,0 +1,107 @@
+/*
+  host_link.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file host_link.h
+ * @brief Virtual optolink and clock for running the engines on a host
+ *
+ * HostLink is the engine's transport and clock. Time only advances when the
+ * test says so, and every byte takes the 4800 baud 8E2 byte time to reach
+ * the other side, one after the other like on the wire.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+
+#include "vitoconnect_optolink.h"
+#include "vitoconnect_transport.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+// 12 bits per byte at 4800 baud
+static const uint32_t HOST_BYTE_TIME_US = 12 * 1000000UL / 4800;
+
+class HostLink : public OptolinkTransport, public OptolinkClock {
+ public:
+  // engine side
+  int available() override;
+  uint8_t read() override;
+  uint8_t peek() override;
+  void write(const uint8_t* data, size_t len) override;
+  void flush() override {}
+  uint32_t millis() override { return _nowUs / 1000; }
+
+  uint64_t micros() const { return _nowUs; }
+  void advance(uint32_t ms) { _nowUs += ms * 1000ULL; }
+
+  // device side
+  void deviceWrite(const uint8_t* data, size_t len);
+  // next byte sent by the engine that has arrived by now
+  bool deviceRead(uint8_t* data);
+  // bytes on their way to the engine
+  size_t toEngine() const { return _toEngine.size(); }
+
+  /**
+   * @brief Called for every byte put on the line, eg. to inject faults.
+   *
+   * Gets the direction and may change the byte, returns false to drop it.
+   */
+  std::function<bool(bool toDevice, uint8_t& data)> filter;
+
+ private:
+  struct Byte {
+    uint64_t arrival;
+    uint8_t data;
+  };
+  void _send(std::deque<Byte>& line, uint64_t& busyUntil, bool toDevice, const uint8_t* data, size_t len);
+
+  uint64_t _nowUs{0};
+  std::deque<Byte> _toEngine;
+  std::deque<Byte> _toDevice;
+  uint64_t _toEngineBusy{0};
+  uint64_t _toDeviceBusy{0};
+};
+
+/**
+ * @brief Simulated Vitotronic on the other end of a HostLink.
+ */
+class SimulatedDevice {
+ public:
+  virtual ~SimulatedDevice() {}
+  virtual void loop() = 0;
+};
+
+/**
+ * @brief Run engine and device for (ms) milliseconds in 1 ms steps.
+ */
+void runFor(HostLink& link, Optolink& engine, SimulatedDevice& device, uint32_t ms);
+
+/**
+ * @brief Run until the engine's queue is empty, at most (ms) milliseconds.
+ *
+ * @return true The queue is empty
+ */
+bool runUntilIdle(HostLink& link, Optolink& engine, SimulatedDevice& device, uint32_t ms);
+
+}  // namespace vitoconnect
+}  // namespace esphome
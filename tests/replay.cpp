@@ -0,0 +1,77 @@
+/*
+  replay.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file replay.cpp
+ * @brief Replays a capture log to an engine and prints the values
+ *
+ *   replay P300|KW|GWG <log>
+ *
+ * The log has to start with the connection setup, eg. capture enabled from
+ * boot. Prints one JSON object per callback and returns 1 if the engine
+ * sent something else than captured or didn't finish.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esphome/core/log.h"
+#include "capture_replay.h"
+#include "vitoconnect_codec.h"
+
+using namespace esphome::vitoconnect;
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s P300|KW|GWG <log>\n", argv[0]);
+    return 2;
+  }
+  ReplayProtocol protocol;
+  if (strcmp(argv[1], "P300") == 0) {
+    protocol = REPLAY_P300;
+  } else if (strcmp(argv[1], "KW") == 0) {
+    protocol = REPLAY_KW;
+  } else if (strcmp(argv[1], "GWG") == 0) {
+    protocol = REPLAY_GWG;
+  } else {
+    fprintf(stderr, "unknown protocol %s\n", argv[1]);
+    return 2;
+  }
+  FILE* file = fopen(argv[2], "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", argv[2]);
+    return 2;
+  }
+  std::vector<CaptureLine> capture = readCapture(file);
+  fclose(file);
+
+  esphome::host_log_level(ESPHOME_LOG_LEVEL_NONE);
+  ReplayResult result = replay(protocol, capture);
+  for (const ReplayValue& value : result.values) {
+    printf("{\"address\":\"0x%04X\",\"write\":%s,", value.address, value.write ? "true" : "false");
+    if (value.error) {
+      printf("\"error\":%u}\n", value.data[0]);
+    } else {
+      printf("\"data\":\"%s\"}\n", decodeRaw(value.data.data(), value.data.size()).c_str());
+    }
+  }
+  fprintf(stderr, "%u lines, %u callbacks, %u mismatched bytes%s\n", (unsigned) capture.size(),
+          (unsigned) result.values.size(), (unsigned) result.mismatches, result.complete ? "" : ", incomplete");
+  return (result.mismatches == 0 && result.complete) ? 0 : 1;
+}
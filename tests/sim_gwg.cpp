@@ -0,0 +1,154 @@
+/*
+  sim_gwg.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sim_gwg.h"
+
+#include <string.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+// Gap after which an unanswered READY, an incomplete request or a burst
+// is given up
+static const uint32_t SIM_GWG_GAP_MS = 50;
+
+struct TelegramType {
+  uint8_t type;
+  GWGRegion region;
+  bool write;
+};
+
+static const TelegramType TELEGRAM_TYPES[] = {
+  {0xC7, GWG_VIRTUAL, false},     {0xC4, GWG_VIRTUAL, true},
+  {0xCB, GWG_PHYSICAL, false},    {0xC8, GWG_PHYSICAL, true},
+  {0xAE, GWG_EEPROM, false},      {0xAD, GWG_EEPROM, true},
+  {0xC5, GWG_XRAM, false},        {0xC3, GWG_XRAM, true},
+  {0x6E, GWG_PORT, false},        {0x6D, GWG_PORT, true},
+  {0x9E, GWG_BE, false},          {0x9D, GWG_BE, true},
+  {0x33, GWG_KMBUS_RAM, false},   {0x43, GWG_KMBUS_EEPROM, false},
+};
+
+static const TelegramType* telegramType(uint8_t type) {
+  for (const TelegramType& entry : TELEGRAM_TYPES) {
+    if (entry.type == type) return &entry;
+  }
+  return nullptr;
+}
+
+SimGWG::SimGWG(HostLink* link) : _link(link) {
+  memset(memory, 0, sizeof(memory));
+}
+
+void SimGWG::loop() {
+  uint32_t now = _link->millis();
+  uint8_t data;
+  while (_link->deviceRead(&data)) _receive(data, now);
+
+  int32_t elapsed = now - _stateMillis;
+  switch (_state) {
+  case SYNC:
+    if (elapsed >= (int32_t) syncPeriod) {
+      const uint8_t ready[] = {0x05};
+      _link->deviceWrite(ready, sizeof(ready));
+      ++readys;
+      _burst = 0;
+      _state = WAIT_ACK;
+      _stateMillis = now;
+    }
+    break;
+  case WAIT_ACK:
+  case REQUEST:
+  case BURST:
+    if (elapsed > (int32_t) SIM_GWG_GAP_MS) {
+      _state = SYNC;
+      _stateMillis = now;
+    }
+    break;
+  case ANSWER:
+    if (elapsed >= (int32_t) responseDelay) {
+      _link->deviceWrite(_answer.data(), _answer.size());
+      _state = BURST;
+      _stateMillis = now;
+    }
+    break;
+  }
+}
+
+void SimGWG::_receive(uint8_t data, uint32_t now) {
+  switch (_state) {
+  case WAIT_ACK:
+    if (data == 0x01) {
+      _state = REQUEST;
+      _stateMillis = now;
+      _rx.clear();
+    }
+    break;
+  case BURST:
+    _state = REQUEST;
+    _rx.clear();
+    _receive(data, now);
+    break;
+  case REQUEST: {
+    _rx.push_back(data);
+    _stateMillis = now;
+    const TelegramType* type = telegramType(_rx[0]);
+    if (!type) {
+      _state = SYNC;
+    } else if (_rx.size() >= 4 && _rx.size() >= 4U + (type->write ? _rx[2] : 0)) {
+      _request(now);
+    }
+    break;
+  }
+  default:
+    // not listening
+    break;
+  }
+}
+
+void SimGWG::_request(uint32_t now) {
+  if (burstTolerance && _burst >= burstTolerance) {
+    // the controller has stopped listening
+    ++ignored;
+    _state = SYNC;
+    _stateMillis = now;
+    return;
+  }
+  ++_burst;
+  const TelegramType* type = telegramType(_rx[0]);
+  uint8_t address = _rx[1];
+  uint8_t length = _rx[2];
+  _answer.clear();
+  if (type->write) {
+    ++writes;
+    if (rejectWrites) {
+      _answer.push_back(0x15);
+    } else {
+      for (uint8_t i = 0; i < length; ++i) memory[type->region][(uint8_t) (address + i)] = _rx[4 + i];
+      _answer.push_back(0x00);
+    }
+  } else {
+    ++reads;
+    for (uint8_t i = 0; i < length; ++i) _answer.push_back(memory[type->region][(uint8_t) (address + i)]);
+  }
+  _state = ANSWER;
+  _stateMillis = now;
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,84 @@
+/*
+  sim_gwg.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "host_link.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Memory regions of a GWG controller, addressed by the telegram type.
+ */
+enum GWGRegion : uint8_t {
+  GWG_VIRTUAL,
+  GWG_PHYSICAL,
+  GWG_EEPROM,
+  GWG_XRAM,
+  GWG_PORT,
+  GWG_BE,
+  GWG_KMBUS_RAM,
+  GWG_KMBUS_EEPROM,
+  GWG_REGIONS
+};
+
+/**
+ * @brief Simulated controller speaking GWG.
+ *
+ * Sends READY (0x05) every (syncPeriod) while idle. The request following
+ * the ACK (0x01) is answered after (responseDelay), further requests are
+ * taken without a new READY up to (burstTolerance) requests in total.
+ * Requests beyond that are ignored until the next READY.
+ */
+class SimGWG : public SimulatedDevice {
+ public:
+  explicit SimGWG(HostLink* link);
+  void loop() override;
+
+  uint8_t memory[GWG_REGIONS][0x100];
+  uint32_t syncPeriod{500};
+  uint32_t responseDelay{5};
+  uint8_t burstTolerance{0};   ///< requests per READY, 0: unlimited
+  bool rejectWrites{false};    ///< answer writes with 0x15 and keep the memory
+
+  // counters
+  uint32_t readys{0};
+  uint32_t reads{0};
+  uint32_t writes{0};
+  uint32_t ignored{0};        ///< requests beyond the burst tolerance
+
+ private:
+  enum State : uint8_t { SYNC, WAIT_ACK, REQUEST, ANSWER, BURST };
+  void _receive(uint8_t data, uint32_t now);
+  void _request(uint32_t now);
+
+  HostLink* _link;
+  State _state{SYNC};
+  uint32_t _stateMillis{0};
+  uint8_t _burst{0};
+  std::vector<uint8_t> _rx;
+  std::vector<uint8_t> _answer;
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
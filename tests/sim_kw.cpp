@@ -0,0 +1,130 @@
+/*
+  sim_kw.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sim_kw.h"
+
+#include <string.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+// Gap after which an unanswered sync or an incomplete request is given up
+static const uint32_t SIM_KW_GAP_MS = 50;
+// A byte is complete this long after it started
+static const uint32_t SIM_KW_BYTE_MS = (HOST_BYTE_TIME_US + 999) / 1000;
+
+SimKW::SimKW(HostLink* link) : _link(link) {
+  memset(memory, 0, sizeof(memory));
+}
+
+void SimKW::loop() {
+  uint32_t now = _link->millis();
+  uint8_t data;
+  while (_link->deviceRead(&data)) _receive(data, now);
+
+  int32_t elapsed = now - _stateMillis;
+  switch (_state) {
+  case SYNC:
+    if (elapsed >= (int32_t) syncPeriod) {
+      _send({0x05});
+      ++syncs;
+      _state = WAIT_ACK;
+      _stateMillis = now;
+    }
+    break;
+  case WAIT_ACK:
+  case REQUEST:
+    if (elapsed > (int32_t) SIM_KW_GAP_MS) {
+      _state = SYNC;
+      _stateMillis = now;
+    }
+    break;
+  case ANSWER:
+    if (elapsed >= (int32_t) responseDelay) {
+      _send(_answer);
+      _state = DIRECT;
+      // end of the answer on the wire
+      _stateMillis = now + _answer.size() * SIM_KW_BYTE_MS;
+    }
+    break;
+  case DIRECT:
+    if (elapsed > (int32_t) (directWindow + SIM_KW_BYTE_MS)) {
+      _state = SYNC;
+      _stateMillis = now;
+    }
+    break;
+  }
+}
+
+void SimKW::_receive(uint8_t data, uint32_t now) {
+  switch (_state) {
+  case WAIT_ACK:
+    if (data == 0x01) {
+      _state = REQUEST;
+      _stateMillis = now;
+      _rx.clear();
+    }
+    break;
+  case DIRECT:
+    // the request started within the window
+    if ((int32_t) (now - _stateMillis) <= (int32_t) (directWindow + SIM_KW_BYTE_MS)) {
+      ++directRequests;
+      _state = REQUEST;
+      _rx.clear();
+      _receive(data, now);
+    }
+    break;
+  case REQUEST:
+    _rx.push_back(data);
+    _stateMillis = now;
+    if (_rx[0] != 0xF7 && _rx[0] != 0xF4) {
+      _state = SYNC;
+    } else if (_rx.size() >= 4) {
+      _request(now);
+    }
+    break;
+  default:
+    // not listening
+    break;
+  }
+}
+
+void SimKW::_request(uint32_t now) {
+  uint16_t address = (_rx[1] << 8) | _rx[2];
+  uint8_t length = _rx[3];
+  if (_rx[0] == 0xF7) {
+    ++reads;
+    _answer.clear();
+    for (uint8_t i = 0; i < length; ++i) _answer.push_back(memory[(uint16_t) (address + i)]);
+  } else {
+    if (_rx.size() < (size_t) length + 4) return;
+    ++writes;
+    for (uint8_t i = 0; i < length; ++i) memory[(uint16_t) (address + i)] = _rx[4 + i];
+    _answer = {0x00};
+  }
+  _state = ANSWER;
+  _stateMillis = now;
+}
+
+void SimKW::_send(const std::vector<uint8_t>& data) {
+  if (!silent) _link->deviceWrite(data.data(), data.size());
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
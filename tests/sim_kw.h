@@ -0,0 +1,69 @@
+/*
+  sim_kw.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "host_link.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Simulated Vitotronic speaking KW.
+ *
+ * Sends the sync 0x05 every (syncPeriod) while idle. A request following
+ * the 0x01 reply to a sync is answered after (responseDelay), further
+ * requests are taken without a new sync as long as they start within
+ * (directWindow) after the end of the previous answer.
+ */
+class SimKW : public SimulatedDevice {
+ public:
+  explicit SimKW(HostLink* link);
+  void loop() override;
+
+  uint8_t memory[0x10000];
+  uint32_t syncPeriod{2000};
+  uint32_t responseDelay{5};   ///< ms from the end of a request to its answer
+  uint32_t directWindow{10};   ///< ms after an answer to send the next request
+  bool silent{false};          ///< receive, but never send anything
+
+  // counters
+  uint32_t syncs{0};
+  uint32_t reads{0};
+  uint32_t writes{0};
+  uint32_t directRequests{0};  ///< requests without a sync before
+
+ private:
+  enum State : uint8_t { SYNC, WAIT_ACK, REQUEST, ANSWER, DIRECT };
+  void _receive(uint8_t data, uint32_t now);
+  void _request(uint32_t now);
+  void _send(const std::vector<uint8_t>& data);
+
+  HostLink* _link;
+  State _state{SYNC};
+  uint32_t _stateMillis{0};
+  std::vector<uint8_t> _rx;
+  std::vector<uint8_t> _answer;
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,122 @@
+/*
+  sim_p300.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sim_p300.h"
+
+#include <string.h>
+
+namespace esphome {
+namespace vitoconnect {
+
+// An incomplete frame is dropped after this gap
+static const uint32_t SIM_P300_FRAME_GAP_MS = 100;
+
+static uint8_t checksum(const std::vector<uint8_t>& frame) {
+  uint8_t sum = 0;
+  for (size_t i = 1; i + 1 < frame.size(); ++i) sum += frame[i];
+  return sum;
+}
+
+SimP300::SimP300(HostLink* link) : _link(link) {
+  memset(memory, 0, sizeof(memory));
+}
+
+void SimP300::loop() {
+  uint32_t now = _link->millis();
+  uint8_t data;
+  while (_link->deviceRead(&data)) {
+    _receive(data);
+    _rxMillis = now;
+  }
+  if (!_rx.empty() && now - _rxMillis > SIM_P300_FRAME_GAP_MS) _rx.clear();
+  if (!_answer.empty() && now - _answerMillis >= responseDelay) {
+    _send(_answer);
+    _answer.clear();
+  }
+  if (!_connected && now - _lastSync >= syncPeriod) {
+    _send({0x05});
+    _lastSync = now;
+  }
+}
+
+void SimP300::_receive(uint8_t data) {
+  if (_rx.empty()) {
+    if (data == 0x04) {
+      // back to KW, which is announced by an enquiry
+      ++resets;
+      _connected = false;
+      _answer.clear();
+      _send({0x05});
+      _lastSync = _link->millis();
+      return;
+    }
+    if (data != 0x16 && data != 0x41) return;  // eg. the ack of an answer
+  }
+  _rx.push_back(data);
+  if (_rx[0] == 0x16) {
+    if (_rx.size() < 3) return;
+    if (_rx[1] == 0x00 && _rx[2] == 0x00) {
+      ++inits;
+      _connected = true;
+      _send({0x06});
+    }
+    _rx.clear();
+    return;
+  }
+  if (_rx.size() >= 2 && _rx.size() == (size_t) _rx[1] + 3) {
+    if (_connected) _frame();
+    _rx.clear();
+  }
+}
+
+void SimP300::_frame() {
+  if (_rx[_rx.size() - 1] != checksum(_rx) || _rx.size() < 8) {
+    ++nacks;
+    _send({0x15});
+    return;
+  }
+  _send({0x06});
+  uint8_t function = _rx[3];
+  uint16_t address = (_rx[4] << 8) | _rx[5];
+  uint8_t length = _rx[6];
+  std::vector<uint8_t> answer = {0x41, 0x00, 0x01, function, _rx[4], _rx[5], length};
+  if (errorAddresses.count(address)) {
+    answer[2] = 0x03;
+  } else if (function == 0x01) {
+    ++reads;
+    for (uint8_t i = 0; i < length; ++i) answer.push_back(memory[(uint16_t) (address + i)]);
+  } else if (function == 0x02 && _rx.size() == (size_t) length + 8) {
+    ++writes;
+    for (uint8_t i = 0; i < length; ++i) memory[(uint16_t) (address + i)] = _rx[7 + i];
+  } else {
+    answer[2] = 0x03;
+  }
+  answer.push_back(0);
+  answer[1] = answer.size() - 3;
+  answer[answer.size() - 1] = checksum(answer);
+  _answer = answer;
+  _answerMillis = _link->millis();
+}
+
+void SimP300::_send(const std::vector<uint8_t>& data) {
+  if (!silent) _link->deviceWrite(data.data(), data.size());
+}
+
+}  // namespace vitoconnect
+}  // namespace esphome
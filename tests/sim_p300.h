@@ -0,0 +1,73 @@
+/*
+  sim_p300.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <set>
+#include <vector>
+
+#include "host_link.h"
+
+namespace esphome {
+namespace vitoconnect {
+
+/**
+ * @brief Simulated Vitotronic speaking P300.
+ *
+ * Until it is switched to P300 by 0x16 0x00 0x00 it sends the enquiry 0x05
+ * periodically and in reply to a reset (0x04). Request frames are
+ * acknowledged with 0x06, or 0x15 if the checksum is wrong, and answered
+ * after (responseDelay) from (memory).
+ */
+class SimP300 : public SimulatedDevice {
+ public:
+  explicit SimP300(HostLink* link);
+  void loop() override;
+
+  uint8_t memory[0x10000];
+  uint32_t responseDelay{20};      ///< ms from the end of a request to its answer
+  uint32_t syncPeriod{2000};       ///< enquiry period while not connected
+  std::set<uint16_t> errorAddresses;  ///< reads and writes answered with an error frame
+  bool silent{false};              ///< receive, but never send anything
+
+  // counters
+  uint32_t resets{0};
+  uint32_t inits{0};
+  uint32_t reads{0};
+  uint32_t writes{0};
+  uint32_t nacks{0};
+  bool connected() const { return _connected; }
+
+ private:
+  void _receive(uint8_t data);
+  void _frame();
+  void _send(const std::vector<uint8_t>& data);
+
+  HostLink* _link;
+  bool _connected{false};
+  std::vector<uint8_t> _rx;
+  uint32_t _rxMillis{0};
+  uint32_t _lastSync{0};
+  std::vector<uint8_t> _answer;
+  uint32_t _answerMillis{0};
+};
+
+}  // namespace vitoconnect
+}  // namespace esphome
@@ -0,0 +1,229 @@
+/*
+  soak.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file soak.cpp
+ * @brief Heap use of the hub while polling and writing for a long time
+ *
+ * Runs the hub with a simulated Vitotronic of each protocol, counting
+ * every operator new in the hub's loop(), update() and write(). The
+ * simulator and the link's queues (a uart's fixed buffers on the device)
+ * aren't counted. After a few warm-up updates, polling and writing must
+ * not allocate anymore: without allocations the heap can't fragment
+ * either. Prints one JSON object per protocol.
+ *
+ *   soak [updates]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cstddef>
+#include <new>
+
+#include "esphome/core/log.h"
+#include "host_hub.h"
+#include "sensor/vitoconnect_sensor.h"
+#include "sim_gwg.h"
+#include "sim_kw.h"
+#include "sim_p300.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+// Counting allocator, every block carries its size in front
+static const size_t HEADER = alignof(std::max_align_t);
+static const size_t COUNTED = ~(SIZE_MAX >> 1);
+static bool counting = false;
+static size_t allocations = 0;
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;  // of the hub, since its setup()
+
+static void* allocate(size_t size) {
+  uint8_t* block = static_cast<uint8_t*>(malloc(size + HEADER));
+  if (!block) throw std::bad_alloc();
+  *reinterpret_cast<size_t*>(block) = size | (counting ? COUNTED : 0);
+  if (!counting) return block + HEADER;
+  ++allocations;
+  liveBytes += size;
+  if (liveBytes > peakBytes) peakBytes = liveBytes;
+  return block + HEADER;
+}
+
+static void release(void* ptr) {
+  if (!ptr) return;
+  uint8_t* block = static_cast<uint8_t*>(ptr) - HEADER;
+  size_t size = *reinterpret_cast<size_t*>(block);
+  if (size & COUNTED) liveBytes -= size & ~COUNTED;
+  free(block);
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { release(ptr); }
+
+static const uint32_t UPDATE_INTERVAL = 10000;
+static const uint32_t WARMUP_UPDATES = 3;
+static const uint32_t DEFAULT_UPDATES = 1000;
+static const uint8_t SENSORS = 20;
+
+// Pauses counting while the hub uses the link
+class SoakUART : public HostUART {
+ public:
+  using HostUART::HostUART;
+  bool read_array(uint8_t* data, size_t len) override {
+    Pause pause;
+    return HostUART::read_array(data, len);
+  }
+  void write_array(const uint8_t* data, size_t len) override {
+    Pause pause;
+    HostUART::write_array(data, len);
+  }
+
+ private:
+  struct Pause {
+    bool was{counting};
+    Pause() { counting = false; }
+    ~Pause() { counting = was; }
+  };
+};
+
+// Like runHub(), counting in the hub only
+static void run(HostLink& link, VitoConnect& hub, SimulatedDevice& device, uint32_t ms) {
+  for (uint32_t i = 0; i < ms; ++i) {
+    link.advance(1);
+    device.loop();
+    counting = true;
+    hub.loop();
+    if (link.millis() % UPDATE_INTERVAL == 0) hub.update();
+    counting = false;
+  }
+}
+
+struct Config {
+  uint16_t address;
+  DatapointType type;
+  uint32_t divisor;
+};
+
+static const Config SENSOR_CONFIG[SENSORS] = {
+  {0x00, DP_UINT8, 1},   {0x01, DP_UINT8, 2},   {0x02, DP_INT16, 10},  {0x04, DP_INT16, 10},
+  {0x06, DP_UINT16, 1},  {0x08, DP_UINT32, 1},  {0x0C, DP_INT8, 1},    {0x10, DP_UINT16, 10},
+  {0x12, DP_UINT16, 10}, {0x20, DP_INT16, 10},  {0x22, DP_INT16, 10},  {0x30, DP_UINT8, 1},
+  {0x31, DP_UINT8, 1},   {0x40, DP_UINT32, 3600}, {0x48, DP_INT32, 1}, {0x50, DP_UINT16, 1},
+  {0x60, DP_INT16, 10},  {0x70, DP_UINT8, 1},   {0x80, DP_UINT16, 10}, {0x90, DP_UINT8, 1},
+};
+
+struct Result {
+  uint32_t updates{0};
+  uint32_t loops{0};
+  uint32_t writes{0};
+  uint32_t values{0};
+  size_t allocations{0};
+  size_t peakBytes{0};
+  long liveGrowth{0};
+};
+
+template<typename Device>
+static Result soak(const char* protocol, uint16_t base, uint32_t updates) {
+  HostLink link;
+  hostHubLink(&link);
+  SoakUART uart(&link);
+  Device device(&link);
+
+  Result result;
+  {
+    VitoConnect hub;
+    hub.set_uart_parent(&uart);
+    hub.set_protocol(protocol);
+    hub.set_update_interval(UPDATE_INTERVAL);
+
+    OPTOLINKSensor sensors[SENSORS];
+    for (uint8_t i = 0; i < SENSORS; ++i) {
+      sensors[i].setAddress(base + SENSOR_CONFIG[i].address);
+      sensors[i].setType(SENSOR_CONFIG[i].type);
+      sensors[i].setDivisor(SENSOR_CONFIG[i].divisor);
+      hub.register_datapoint(&sensors[i]);
+      sensors[i].add_on_state_callback([&result](float) { ++result.values; });
+    }
+    // the other scheduling and publishing paths
+    sensors[1].setBitmask(0x0F);
+    sensors[2].set_aggregate(3 * UPDATE_INTERVAL, 16);
+    sensors[3].setAdaptiveInterval(UPDATE_INTERVAL, 6 * UPDATE_INTERVAL, 0.5f);
+    sensors[12].setPollCondition(&sensors[11], 1, 3 * UPDATE_INTERVAL);
+    size_t baseBytes = liveBytes;
+    peakBytes = liveBytes;
+    counting = true;
+    hub.setup();
+    counting = false;
+
+    run(link, hub, device, WARMUP_UPDATES * UPDATE_INTERVAL);
+    size_t startAllocations = allocations;
+    size_t startBytes = liveBytes;
+    result.values = 0;
+
+    for (uint32_t update = 0; update < updates; ++update) {
+      // a setting changed once per update
+      counting = true;
+      if (hub.write(&sensors[19], update % 2)) ++result.writes;
+      counting = false;
+      run(link, hub, device, UPDATE_INTERVAL);
+    }
+
+    result.updates = updates;
+    result.loops = updates * UPDATE_INTERVAL;
+    result.allocations = allocations - startAllocations;
+    result.peakBytes = peakBytes - baseBytes;
+    result.liveGrowth = (long) liveBytes - (long) startBytes;
+  }
+  hostHubLink(nullptr);
+  return result;
+}
+
+static void report(const char* protocol, const Result& result) {
+  printf("{\"protocol\":\"%s\",\"updates\":%u,\"loops\":%u,\"values\":%u,\"writes\":%u,\"allocations\":%u,"
+         "\"allocations_per_update\":%.3f,\"peak_heap_bytes\":%u,\"heap_growth_bytes\":%ld}\n",
+         protocol, (unsigned) result.updates, (unsigned) result.loops, (unsigned) result.values, (unsigned) result.writes,
+         (unsigned) result.allocations, result.updates ? (double) result.allocations / result.updates : 0.0,
+         (unsigned) result.peakBytes, result.liveGrowth);
+  CHECK_EQ(result.allocations, 0);
+  CHECK_EQ(result.liveGrowth, 0);
+  CHECK_EQ(result.writes, result.updates);
+  // most sensors are published every update
+  CHECK(result.values > result.updates * SENSORS / 2);
+}
+
+int main(int argc, char** argv) {
+  uint32_t updates = argc > 1 ? strtoul(argv[1], nullptr, 10) : DEFAULT_UPDATES;
+  esphome::host_log_level(ESPHOME_LOG_LEVEL_NONE);
+  report("P300", soak<SimP300>("P300", 0x2000, updates));
+  report("KW", soak<SimKW>("KW", 0x2000, updates));
+  report("GWG", soak<SimGWG>("GWG", 0x0000, updates));
+  return testResult();
+}
@@ -0,0 +1,59 @@
+/*
+  sensor.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file sensor.h
+ * @brief Host replacement of the ESPHome sensor
+ */
+
+#pragma once
+
+#include <math.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    this->has_state_ = true;
+    for (auto& callback : this->callbacks_) callback(state);
+  }
+  void add_on_state_callback(std::function<void(float)>&& callback) { this->callbacks_.push_back(std::move(callback)); }
+  bool has_state() const { return this->has_state_; }
+
+  void set_name(const std::string& name) { this->name_ = name; }
+  const std::string& get_name() const { return this->name_; }
+
+  float state{NAN};
+
+ protected:
+  bool has_state_{false};
+  std::string name_;
+  std::vector<std::function<void(float)>> callbacks_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
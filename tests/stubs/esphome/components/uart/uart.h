@@ -0,0 +1,58 @@
+/*
+  uart.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file uart.h
+ * @brief Host replacement of the ESPHome uart device
+ */
+
+#pragma once
+
+#include "esphome/components/uart/uart_component.h"
+
+namespace esphome {
+namespace uart {
+
+class UARTDevice {
+ public:
+  UARTDevice() {}
+  explicit UARTDevice(UARTComponent* parent) : parent_(parent) {}
+
+  void set_uart_parent(UARTComponent* parent) { this->parent_ = parent; }
+
+  int available() { return this->parent_->available(); }
+  int read() {
+    uint8_t data;
+    return this->parent_->read_array(&data, 1) ? data : -1;
+  }
+  int peek() {
+    uint8_t data;
+    return this->parent_->peek_byte(&data) ? data : -1;
+  }
+  void write_array(const uint8_t* data, size_t len) { this->parent_->write_array(data, len); }
+  void flush() { this->parent_->flush(); }
+  void check_uart_settings(uint32_t baud_rate, uint8_t stop_bits = 1,
+                           UARTParityOptions parity = UART_CONFIG_PARITY_NONE, uint8_t data_bits = 8) {}
+
+ protected:
+  UARTComponent* parent_{nullptr};
+};
+
+}  // namespace uart
+}  // namespace esphome
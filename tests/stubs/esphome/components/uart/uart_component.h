@@ -0,0 +1,50 @@
+/*
+  uart_component.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file uart_component.h
+ * @brief Host replacement of the ESPHome uart bus
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome {
+namespace uart {
+
+enum UARTParityOptions {
+  UART_CONFIG_PARITY_NONE,
+  UART_CONFIG_PARITY_EVEN,
+  UART_CONFIG_PARITY_ODD,
+};
+
+class UARTComponent {
+ public:
+  virtual ~UARTComponent() {}
+  virtual int available() = 0;
+  virtual bool read_array(uint8_t* data, size_t len) = 0;
+  virtual bool peek_byte(uint8_t* data) = 0;
+  virtual void write_array(const uint8_t* data, size_t len) = 0;
+  virtual void flush() = 0;
+};
+
+}  // namespace uart
+}  // namespace esphome
@@ -0,0 +1,36 @@
+/*
+  hal.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file hal.h
+ * @brief Host replacement of the ESPHome time functions
+ *
+ * Defined by the test, see host_hub.h.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+
+}  // namespace esphome
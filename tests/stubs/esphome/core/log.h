@@ -0,0 +1,63 @@
+/*
+  log.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file log.h
+ * @brief Host replacement of the ESPHome logger for the tests
+ *
+ * Messages are formatted like on the device. Warnings and errors are
+ * printed, everything else is only passed to a sink installed by a test.
+ */
+
+#pragma once
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+namespace esphome {
+
+typedef void (*HostLogSink)(int level, const char* tag, const char* message);
+
+void host_log(int level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Receive all log messages, nullptr to print them again.
+ */
+void host_log_sink(HostLogSink sink);
+
+/**
+ * @brief Print messages up to (level) when no sink is installed.
+ */
+void host_log_level(int level);
+
+}  // namespace esphome
+
+#define ESP_LOGE(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) ::esphome::host_log(ESPHOME_LOG_LEVEL_VERY_VERBOSE, tag, __VA_ARGS__)
@@ -0,0 +1,69 @@
+/*
+  preferences.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file preferences.h
+ * @brief Host replacement of the ESPHome preferences, kept in memory
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() {}
+  explicit ESPPreferenceObject(std::vector<uint8_t>* data) : data_(data) {}
+
+  template<typename T> bool save(const T* src) {
+    if (!data_) return false;
+    data_->assign(reinterpret_cast<const uint8_t*>(src), reinterpret_cast<const uint8_t*>(src) + sizeof(T));
+    return true;
+  }
+  template<typename T> bool load(T* dest) {
+    if (!data_ || data_->size() != sizeof(T)) return false;
+    memcpy(dest, data_->data(), sizeof(T));
+    return true;
+  }
+
+ private:
+  std::vector<uint8_t>* data_{nullptr};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type) {
+    return ESPPreferenceObject(&store_[type]);
+  }
+  bool sync() { return true; }
+  // forget everything, like a fresh flash
+  void clear() { store_.clear(); }
+
+ private:
+  std::map<uint32_t, std::vector<uint8_t>> store_;
+};
+
+extern ESPPreferences* global_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,52 @@
+/*
+  log.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "esphome/core/log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+namespace esphome {
+
+static HostLogSink sink = nullptr;
+static int printLevel = ESPHOME_LOG_LEVEL_WARN;
+
+void host_log(int level, const char* tag, const char* format, ...) {
+  if (!sink && level > printLevel) return;
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  if (sink) {
+    sink(level, tag, message);
+  } else {
+    fprintf(stderr, "[%s] %s\n", tag, message);
+  }
+}
+
+void host_log_sink(HostLogSink newSink) {
+  sink = newSink;
+}
+
+void host_log_level(int level) {
+  printLevel = level;
+}
+
+}  // namespace esphome
@@ -0,0 +1,57 @@
+/*
+  test.h - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file test.h
+ * @brief Minimal checks for the host tests, one executable per test file
+ *
+ * Failed checks are printed and counted, main() returns testResult().
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+namespace test {
+inline int failures = 0;
+}  // namespace test
+
+#define CHECK(condition)                                                          \
+  do {                                                                            \
+    if (!(condition)) {                                                           \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      ++test::failures;                                                           \
+    }                                                                             \
+  } while (0)
+
+#define CHECK_EQ(actual, expected)                                                \
+  do {                                                                            \
+    long long _actual = (long long) (actual);                                     \
+    long long _expected = (long long) (expected);                                 \
+    if (_actual != _expected) {                                                   \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__,   \
+              #actual, _actual, _expected);                                       \
+      ++test::failures;                                                           \
+    }                                                                             \
+  } while (0)
+
+inline int testResult() {
+  if (test::failures) fprintf(stderr, "%d checks failed\n", test::failures);
+  return test::failures ? 1 : 0;
+}
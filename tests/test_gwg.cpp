@@ -0,0 +1,175 @@
+/*
+  test_gwg.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "sim_gwg.h"
+#include "vitoconnect_optolinkGWG.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+static std::vector<uint8_t> received;
+static std::vector<uint8_t> errors;
+static uint32_t answers = 0;
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {
+  received.assign(data, data + len);
+  ++answers;
+}
+
+static void onError(uint8_t error, void* arg) {
+  errors.push_back(error);
+}
+
+struct Fixture {
+  HostLink link;
+  SimGWG device{&link};
+  OptolinkGWG engine{&link, &link};
+
+  Fixture() {
+    engine.onData(onData);
+    engine.onError(onError);
+    engine.begin();
+    received.clear();
+    errors.clear();
+    answers = 0;
+    for (int region = 0; region < GWG_REGIONS; ++region) {
+      for (int i = 0; i < 0x100; ++i) device.memory[region][i] = region * 0x10 + (i & 0x0F);
+    }
+  }
+  bool run(uint32_t ms = 10000) { return runUntilIdle(link, engine, device, ms); }
+  uint8_t read(uint16_t address) {
+    received.clear();
+    engine.read(address, 1);
+    run();
+    return received.empty() ? 0xFF : received[0];
+  }
+};
+
+static void testFunctionTable() {
+  Fixture f;
+  // function in the MSB selects the region, 0x00 is physical
+  CHECK_EQ(f.read(0x0003), 0x13);
+  CHECK_EQ(f.read(0x0103), 0x03);
+  CHECK_EQ(f.read(0x0303), 0x13);
+  CHECK_EQ(f.read(0x0503), 0x23);
+  CHECK_EQ(f.read(0x4903), 0x33);
+  CHECK_EQ(f.read(0x5103), 0x43);
+  CHECK_EQ(f.read(0x5303), 0x53);
+  CHECK_EQ(f.read(0x6503), 0x63);
+  CHECK_EQ(f.read(0x6703), 0x73);
+
+  const uint16_t writes[][2] = {
+    {0x0020, GWG_PHYSICAL}, {0x0220, GWG_VIRTUAL}, {0x0420, GWG_PHYSICAL}, {0x0620, GWG_EEPROM},
+    {0x5020, GWG_XRAM}, {0x5220, GWG_PORT}, {0x5420, GWG_BE},
+  };
+  uint8_t value = 0xA0;
+  for (const auto& write : writes) {
+    f.engine.write(write[0], 1, &value);
+    CHECK(f.run());
+    CHECK_EQ(f.device.memory[write[1]][0x20], value);
+    ++value;
+  }
+  CHECK_EQ(f.device.writes, 7);
+  CHECK_EQ(errors.size(), 0);
+}
+
+static void testInvalidRequests() {
+  Fixture f;
+  uint8_t value = 1;
+  // write with a read function, read with a write function, unknown function,
+  // beyond the 1 byte address range: never sent, the last one is reported
+  f.engine.write(0x0110, 1, &value);
+  f.engine.read(0x0210, 1);
+  f.engine.read(0x7710, 1);
+  f.engine.read(0x00FE, 4);
+  f.engine.read(0x0010, 1);
+  CHECK(f.run());
+  CHECK_EQ(answers, 1);
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], LENGTH);
+  CHECK_EQ(f.engine.stats().errors[LENGTH], 1);
+  CHECK_EQ(f.device.reads, 1);
+  CHECK_EQ(f.device.writes, 0);
+}
+
+static void testRejectedWrite() {
+  // only an ACK confirms a write, the value isn't returned otherwise
+  Fixture f;
+  f.device.rejectWrites = true;
+  uint8_t value = 0xA0;
+  f.engine.write(0x0420, 1, &value);
+  CHECK(f.run());
+  CHECK_EQ(answers, 0);
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], NACK);
+  CHECK_EQ(f.engine.stats().errors[NACK], 1);
+
+  // and on with the next request
+  f.device.rejectWrites = false;
+  f.engine.write(0x0420, 1, &value);
+  CHECK(f.run());
+  CHECK_EQ(answers, 1);
+  CHECK_EQ(f.device.memory[GWG_PHYSICAL][0x20], value);
+}
+
+static uint32_t readAll(uint8_t tolerance, uint8_t limit, uint32_t* ignored) {
+  Fixture f;
+  f.device.burstTolerance = tolerance;
+  f.engine.setBurstLimit(limit);
+  runFor(f.link, f.engine, f.device, 600);
+  for (int i = 0; i < 12; ++i) f.engine.read(i, 2);
+  uint32_t start = f.link.millis();
+  CHECK(f.run(30000));
+  CHECK_EQ(answers, 12);
+  *ignored = f.device.ignored;
+  return f.link.millis() - start;
+}
+
+static void testBurstLimit() {
+  uint32_t ignored;
+  // unlimited bursts with a controller taking them all: one READY
+  uint32_t burst = readAll(0, 0, &ignored);
+  CHECK_EQ(ignored, 0);
+  CHECK(burst < 500 + 12 * 30);
+
+  // controller taking 4 per READY: requests beyond are lost and time out
+  uint32_t lost = readAll(4, 0, &ignored);
+  CHECK(ignored > 0);
+
+  // limited to what the controller takes: no losses and faster
+  uint32_t limited = readAll(4, 4, &ignored);
+  CHECK_EQ(ignored, 0);
+  CHECK(limited < lost);
+  CHECK(limited < 3 * 500 + 12 * 30);
+
+  // 1 disables bursts, a READY per request
+  uint32_t single = readAll(0, 1, &ignored);
+  CHECK_EQ(ignored, 0);
+  CHECK(single > 11 * 500);
+}
+
+int main() {
+  testFunctionTable();
+  testInvalidRequests();
+  testRejectedWrite();
+  testBurstLimit();
+  return testResult();
+}
@@ -0,0 +1,157 @@
+/*
+  test_host_link.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "host_link.h"
+#include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_optolinkKW.h"
+#include "vitoconnect_optolinkP300.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+// Answers fixed byte sequences in order, a stand-in until there's a simulator
+class ScriptedDevice : public SimulatedDevice {
+ public:
+  ScriptedDevice(HostLink* link) : _link(link) {}
+
+  void expect(std::vector<uint8_t> request, std::vector<uint8_t> answer) {
+    _script.push_back({request, answer});
+  }
+  void loop() override {
+    uint8_t data;
+    while (_link->deviceRead(&data)) _received.push_back(data);
+    if (_step < _script.size() && _received == _script[_step].request) {
+      _link->deviceWrite(_script[_step].answer.data(), _script[_step].answer.size());
+      _received.clear();
+      ++_step;
+    }
+  }
+  bool done() const { return _step == _script.size(); }
+
+ private:
+  struct Step {
+    std::vector<uint8_t> request;
+    std::vector<uint8_t> answer;
+  };
+  HostLink* _link;
+  std::vector<Step> _script;
+  std::vector<uint8_t> _received;
+  size_t _step{0};
+};
+
+static std::vector<uint8_t> received;
+static int errors = 0;
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {
+  received.assign(data, data + len);
+}
+
+static void onError(uint8_t error, void* arg) {
+  ++errors;
+}
+
+static void testByteTime() {
+  HostLink link;
+  uint8_t data[] = {1, 2, 3};
+  link.deviceWrite(data, sizeof(data));
+  CHECK_EQ(link.available(), 0);
+  link.advance(2);
+  CHECK_EQ(link.available(), 0);
+  link.advance(1);
+  CHECK_EQ(link.available(), 1);
+  link.advance(5);
+  CHECK_EQ(link.available(), 3);
+  CHECK_EQ(link.read(), 1);
+  CHECK_EQ(link.peek(), 2);
+}
+
+static void testP300() {
+  HostLink link;
+  ScriptedDevice device(&link);
+  device.expect({0x04}, {0x05});
+  device.expect({0x16, 0x00, 0x00}, {0x06});
+  device.expect({0x41, 0x05, 0x00, 0x01, 0x08, 0x00, 0x02, 0x10},
+                {0x06, 0x41, 0x07, 0x01, 0x01, 0x08, 0x00, 0x02, 0x34, 0x12, 0x59});
+  OptolinkP300 engine(&link, &link);
+  engine.onData(onData);
+  engine.onError(onError);
+  engine.begin();
+  received.clear();
+  errors = 0;
+
+  engine.read(0x0800, 2);
+  CHECK(runUntilIdle(link, engine, device, 1000));
+  CHECK(device.done());
+  CHECK_EQ(errors, 0);
+  CHECK_EQ(received.size(), 2);
+  CHECK_EQ(received[0], 0x34);
+  CHECK_EQ(engine.stats().transactions, 1);
+}
+
+static void testKW() {
+  HostLink link;
+  ScriptedDevice device(&link);
+  OptolinkKW engine(&link, &link);
+  engine.onData(onData);
+  engine.onError(onError);
+  engine.begin();
+  received.clear();
+  errors = 0;
+
+  engine.read(0x0800, 2);
+  const uint8_t sync[] = {0x05};
+  link.deviceWrite(sync, 1);
+  device.expect({0x01, 0xF7, 0x08, 0x00, 0x02}, {0x34, 0x12});
+  CHECK(runUntilIdle(link, engine, device, 1000));
+  CHECK(device.done());
+  CHECK_EQ(errors, 0);
+  CHECK_EQ(received.size(), 2);
+  CHECK_EQ(received[1], 0x12);
+}
+
+static void testGWG() {
+  HostLink link;
+  ScriptedDevice device(&link);
+  OptolinkGWG engine(&link, &link);
+  engine.onData(onData);
+  engine.onError(onError);
+  engine.begin();
+  received.clear();
+  errors = 0;
+
+  engine.read(0x0055, 1);
+  const uint8_t ready[] = {0x05, 0x05};
+  link.deviceWrite(ready, sizeof(ready));
+  device.expect({0x01, 0xCB, 0x55, 0x01, 0x04}, {0x2A});
+  CHECK(runUntilIdle(link, engine, device, 1000));
+  CHECK(device.done());
+  CHECK_EQ(errors, 0);
+  CHECK_EQ(received.size(), 1);
+  CHECK_EQ(received[0], 0x2A);
+}
+
+int main() {
+  testByteTime();
+  testP300();
+  testKW();
+  testGWG();
+  return testResult();
+}
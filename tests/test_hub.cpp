@@ -0,0 +1,269 @@
+/*
+  test_hub.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "host_hub.h"
+#include "sensor/vitoconnect_sensor.h"
+#include "vitoconnect_block.h"
+#include "sim_p300.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+static const uint32_t UPDATE_INTERVAL = 10000;
+
+// Hub on a simulated P300 Vitotronic, the datapoints are registered by the test
+struct Hub {
+  HostLink link;
+  HostUART uart{&link};
+  SimP300 device{&link};
+  VitoConnect hub;
+
+  Hub() {
+    hostHubLink(&link);
+    hub.set_uart_parent(&uart);
+    hub.set_protocol("P300");
+    hub.set_update_interval(UPDATE_INTERVAL);
+  }
+  ~Hub() { hostHubLink(nullptr); }
+
+  void add(OPTOLINKSensor& sensor, uint16_t address) {
+    sensor.setAddress(address);
+    sensor.setType(DP_UINT8);
+    hub.register_datapoint(&sensor);
+  }
+
+  void run(uint32_t ms) { runHub(link, hub, device, ms); }
+};
+
+static void testLateAnswers() {
+  // answers coming in long after the update must not skip the next one
+  Hub hub;
+  const uint8_t count = 40;
+  OPTOLINKSensor sensors[count];
+  for (uint8_t i = 0; i < count; ++i) hub.add(sensors[i], 0x2000 + i * 0x10);
+  hub.hub.setup();
+  hub.run(2 * UPDATE_INTERVAL);
+
+  uint32_t reads = hub.device.reads;
+  hub.run(10 * UPDATE_INTERVAL);
+  CHECK_EQ(hub.device.reads - reads, 10 * count);
+}
+
+static void testWritePostponesPoll() {
+  Hub hub;
+  OPTOLINKSensor written;
+  OPTOLINKSensor other;
+  hub.add(written, 0x2000);
+  hub.add(other, 0x3000);
+  hub.hub.setup();
+  hub.run(3 * UPDATE_INTERVAL);
+
+  // written shortly before an update, only the other one is read then
+  hub.run(UPDATE_INTERVAL - 2000);
+  CHECK(hub.hub.write(&written, 42));
+  uint32_t reads = hub.device.reads;
+  hub.run(4000);
+  CHECK_EQ(hub.device.writes, 1);
+  CHECK_EQ(written.state, 42);
+  CHECK_EQ(hub.device.reads - reads, 1);
+
+  // and both again one interval after the write
+  reads = hub.device.reads;
+  hub.run(UPDATE_INTERVAL);
+  CHECK_EQ(hub.device.reads - reads, 2);
+}
+
+static void testConditionMetAgain() {
+  // a datapoint on its slower interval is read as soon as its condition
+  // is met again, not at the deadline of the slower interval
+  Hub hub;
+  OPTOLINKSensor guard;
+  OPTOLINKSensor conditional;
+  hub.add(guard, 0x2000);
+  hub.add(conditional, 0x3000);
+  conditional.setPollCondition(&guard, 1, 6 * UPDATE_INTERVAL);
+  uint32_t published = 0;
+  conditional.add_on_state_callback([&published](float) { ++published; });
+  hub.device.memory[0x2000] = 0;
+  hub.hub.setup();
+  hub.run(3 * UPDATE_INTERVAL + 5000);
+  CHECK_EQ(published, 2);  // before and after the guard was known
+
+  // the guard is read at the next update, the datapoint at the one after
+  hub.device.memory[0x2000] = 1;
+  hub.run(2 * UPDATE_INTERVAL);
+  CHECK_EQ(guard.state, 1);
+  CHECK_EQ(published, 3);
+  hub.run(UPDATE_INTERVAL);
+  CHECK_EQ(published, 4);
+}
+
+static void testBitmaskWrite() {
+  // two flags in one byte, written one after the other
+  Hub hub;
+  OPTOLINKSensor low;
+  OPTOLINKSensor high;
+  hub.add(low, 0x2000);
+  hub.add(high, 0x2000);
+  low.setBitmask(0x01);
+  high.setBitmask(0x02);
+  hub.device.memory[0x2000] = 0xF0;
+  hub.hub.setup();
+  // the other bits aren't known yet
+  CHECK(!hub.hub.write(&low, 1));
+  hub.run(UPDATE_INTERVAL + 1000);
+
+  CHECK(hub.hub.write(&low, 1));
+  CHECK(hub.hub.write(&high, 1));
+  hub.run(1000);
+  CHECK_EQ(hub.device.memory[0x2000], 0xF3);
+  CHECK_EQ(low.state, 1);
+  CHECK_EQ(high.state, 1);
+
+  CHECK(hub.hub.write(&low, 0));
+  hub.run(1000);
+  CHECK_EQ(hub.device.memory[0x2000], 0xF2);
+  CHECK_EQ(low.state, 0);
+  CHECK_EQ(high.state, 1);
+}
+
+static void testBlockChildWrite() {
+  // children of a block aren't registered at the hub, they are written anyway
+  Hub hub;
+  DatapointBlock block;
+  OPTOLINKSensor child;
+  block.setAddress(0x2000);
+  block.setLength(4);
+  child.setType(DP_UINT8);
+  block.addChild(&child, 2);
+  hub.hub.register_datapoint(&block);
+  hub.hub.setup();
+  hub.run(UPDATE_INTERVAL + 1000);
+
+  CHECK(hub.hub.write(&child, 42));
+  hub.run(1000);
+  CHECK_EQ(hub.device.writes, 1);
+  CHECK_EQ(hub.device.memory[0x2002], 42);
+  CHECK_EQ(child.state, 42);
+}
+
+static void testOwnInterval() {
+  // one datapoint every 2 s while the hub updates every 10 s
+  Hub hub;
+  OPTOLINKSensor fast;
+  OPTOLINKSensor slow;
+  hub.add(fast, 0x2000);
+  hub.add(slow, 0x3000);
+  fast.setUpdateInterval(2000);
+  uint32_t published = 0;
+  slow.add_on_state_callback([&published](float) { ++published; });
+  hub.hub.setup();
+  hub.run(UPDATE_INTERVAL);
+
+  uint32_t reads = hub.device.reads;
+  hub.run(6 * UPDATE_INTERVAL);
+  // 30 fast ones, at most a tick late each time, and 6 slow ones
+  CHECK(hub.device.reads - reads >= 6 + 28);
+  CHECK(hub.device.reads - reads <= 6 + 30);
+  CHECK_EQ(published, 7);
+}
+
+static void testAdaptiveInterval() {
+  // a constant value slows the polls down right after the read showing it
+  Hub hub;
+  OPTOLINKSensor sensor;
+  hub.add(sensor, 0x2000);
+  sensor.setAdaptiveInterval(2000, 60000, 1);
+  hub.hub.setup();
+  // the first read only gives the starting point, the second one adapts
+  hub.run(2500);
+  CHECK_EQ(hub.device.reads, 2);
+  CHECK_EQ(sensor.getInterval(), 31000);
+  hub.run(20000);
+  CHECK_EQ(hub.device.reads, 2);
+  hub.run(12000);
+  CHECK_EQ(hub.device.reads, 3);
+}
+
+static void testAdaptiveAfterRestore() {
+  // a saved value is from before the reboot, it's no starting point
+  esphome::global_preferences->clear();
+  {
+    Hub hub;
+    OPTOLINKSensor sensor;
+    hub.add(sensor, 0x2000);
+    hub.hub.set_restore_values(true);
+    hub.hub.set_persist_interval(UPDATE_INTERVAL);
+    hub.device.memory[0x2000] = 20;
+    hub.hub.setup();
+    hub.run(3 * UPDATE_INTERVAL);
+  }
+  Hub hub;
+  OPTOLINKSensor sensor;
+  hub.add(sensor, 0x2000);
+  sensor.setAdaptiveInterval(2000, 60000, 1);
+  hub.hub.set_restore_values(true);
+  hub.device.memory[0x2000] = 20;
+  hub.hub.setup();
+  CHECK_EQ(sensor.state, 20);
+  hub.run(1000);
+  CHECK_EQ(hub.device.reads, 1);
+  CHECK_EQ(sensor.getInterval(), 2000);
+  hub.run(2000);
+  CHECK_EQ(hub.device.reads, 2);
+}
+
+static void testAggregateWindow() {
+  Hub hub;
+  OPTOLINKSensor sensor;
+  hub.add(sensor, 0x2000);
+  sensor.setUpdateInterval(3000);
+  sensor.set_aggregate(UPDATE_INTERVAL, 0);
+  esphome::sensor::Sensor mean;
+  sensor.set_mean_sensor(&mean);
+  uint32_t published = 0;
+  sensor.add_on_state_callback([&published](float) { ++published; });
+  hub.device.memory[0x2000] = 10;
+  hub.hub.setup();
+
+  // reads at about 0, 3, 6 and 9 s; the window closes at 10 s without
+  // waiting for the read at 12 s
+  hub.run(7000);
+  hub.device.memory[0x2000] = 30;
+  hub.run(3500);
+  CHECK_EQ(published, 1);
+  CHECK_EQ(sensor.state, 30);
+  CHECK_EQ(mean.state, 15);
+}
+
+int main() {
+  esphome::host_log_level(ESPHOME_LOG_LEVEL_NONE);
+  testLateAnswers();
+  testWritePostponesPoll();
+  testConditionMetAgain();
+  testBitmaskWrite();
+  testBlockChildWrite();
+  testOwnInterval();
+  testAggregateWindow();
+  testAdaptiveInterval();
+  testAdaptiveAfterRestore();
+  return testResult();
+}
@@ -0,0 +1,136 @@
+/*
+  test_kw.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "sim_kw.h"
+#include "vitoconnect_optolinkKW.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+static std::vector<uint8_t> received;
+static std::vector<uint8_t> errors;
+static uint32_t answers = 0;
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {
+  received.assign(data, data + len);
+  ++answers;
+}
+
+static void onError(uint8_t error, void* arg) {
+  errors.push_back(error);
+}
+
+struct Fixture {
+  HostLink link;
+  SimKW device{&link};
+  OptolinkKW engine{&link, &link};
+
+  Fixture() {
+    engine.onData(onData);
+    engine.onError(onError);
+    engine.begin();
+    received.clear();
+    errors.clear();
+    answers = 0;
+    for (int i = 0; i < 0x100; ++i) device.memory[0x0800 + i] = i;
+  }
+  bool run(uint32_t ms = 5000) { return runUntilIdle(link, engine, device, ms); }
+};
+
+static void testReadWrite() {
+  Fixture f;
+  f.engine.read(0x0810, 2);
+  CHECK(f.run());
+  CHECK_EQ(received.size(), 2);
+  CHECK_EQ(received[1], 0x11);
+
+  uint8_t value[] = {7, 8};
+  f.engine.write(0x2000, 2, value);
+  f.engine.read(0x2000, 2);
+  CHECK(f.run());
+  CHECK_EQ(f.device.memory[0x2001], 8);
+  CHECK_EQ(received[0], 7);
+  CHECK_EQ(errors.size(), 0);
+}
+
+static void testDirectSend() {
+  // queued requests follow each other without waiting for the next sync
+  Fixture f;
+  runFor(f.link, f.engine, f.device, 2100);
+  uint32_t syncs = f.device.syncs;
+  for (int i = 0; i < 20; ++i) f.engine.read(0x0800 + i, 2);
+  uint32_t start = f.link.millis();
+  CHECK(f.run());
+  uint32_t duration = f.link.millis() - start;
+  CHECK_EQ(answers, 20);
+  CHECK_EQ(errors.size(), 0);
+  CHECK_EQ(f.device.syncs, syncs + 1);
+  CHECK_EQ(f.device.directRequests, 19);
+  // one sync to wait for, then about 25 ms per read
+  CHECK(duration < f.device.syncPeriod + 20 * 30);
+}
+
+static void testDirectSendSlowLoop() {
+  // the next request leaves with the answer, not with the next loop()
+  Fixture f;
+  for (int i = 0; i < 10; ++i) f.engine.read(0x0800 + i, 1);
+  for (int i = 0; i < 5000 && f.engine.queueSize() > 0; ++i) {
+    f.link.advance(1);
+    f.device.loop();
+    if (i % 9 == 0) f.engine.loop();
+  }
+  CHECK_EQ(answers, 10);
+  CHECK_EQ(f.device.syncs, 1);
+  CHECK_EQ(f.device.directRequests, 9);
+}
+
+static void testLostSync() {
+  // without sync the engine starts over and carries on once it's back
+  Fixture f;
+  f.engine.read(0x0800, 1);
+  CHECK(f.run());
+  f.device.silent = true;
+  runFor(f.link, f.engine, f.device, 8000);
+  f.device.silent = false;
+  f.engine.read(0x0801, 1);
+  CHECK(f.run());
+  CHECK_EQ(received[0], 1);
+  CHECK_EQ(errors.size(), 0);
+}
+
+static void testMissingAnswer() {
+  // a request the Vitotronic ignores fails by the watchdog
+  Fixture f;
+  f.device.responseDelay = 10000;
+  f.engine.read(0x0800, 1);
+  CHECK(f.run(6000));
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], TIMEOUT);
+}
+
+int main() {
+  testReadWrite();
+  testDirectSend();
+  testDirectSendSlowLoop();
+  testLostSync();
+  testMissingAnswer();
+  return testResult();
+}
@@ -0,0 +1,243 @@
+/*
+  test_p300.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <vector>
+
+#include "sim_p300.h"
+#include "vitoconnect_optolinkP300.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+static std::vector<uint8_t> received;
+static std::vector<uint8_t> errors;
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {
+  received.assign(data, data + len);
+}
+
+static void onError(uint8_t error, void* arg) {
+  errors.push_back(error);
+}
+
+struct Fixture {
+  HostLink link;
+  SimP300 device{&link};
+  OptolinkP300 engine{&link, &link};
+
+  Fixture() {
+    engine.onData(onData);
+    engine.onError(onError);
+    engine.begin();
+    received.clear();
+    errors.clear();
+    for (int i = 0; i < 0x100; ++i) device.memory[0x2000 + i] = i;
+  }
+  bool run(uint32_t ms = 2000) { return runUntilIdle(link, engine, device, ms); }
+};
+
+static void testReadWrite() {
+  Fixture f;
+  f.engine.read(0x2010, 2);
+  CHECK(f.run());
+  CHECK_EQ(received.size(), 2);
+  CHECK_EQ(received[1], 0x11);
+
+  uint8_t value[] = {7, 8, 9};
+  f.engine.write(0x3000, 3, value);
+  CHECK(f.run());
+  CHECK_EQ(f.device.memory[0x3002], 9);
+  // the written value is returned
+  CHECK_EQ(received.size(), 3);
+  CHECK_EQ(received[0], 7);
+  CHECK_EQ(errors.size(), 0);
+  CHECK_EQ(f.device.resets, 1);
+}
+
+static void testLongRead() {
+  Fixture f;
+  f.engine.read(0x2000, 20);
+  CHECK(f.run());
+  CHECK_EQ(received.size(), 20);
+  CHECK_EQ(received[19], 19);
+  // transferred in chunks of MAX_DP_LENGTH
+  CHECK_EQ(f.device.reads, 3);
+  CHECK_EQ(f.engine.stats().transactions, 1);
+}
+
+static void testWriteCoalescing() {
+  Fixture f;
+  uint8_t value = 1;
+  f.engine.read(0x2000, 1);
+  f.engine.write(0x3000, 1, &value);
+  for (value = 2; value <= 5; ++value) CHECK(f.engine.updateWrite(0x3000, 1, &value));
+  CHECK(f.run());
+  CHECK_EQ(f.device.writes, 1);
+  CHECK_EQ(f.device.memory[0x3000], 5);
+}
+
+static void testResponseLatency() {
+  // the longest answer still arrives in time when the Vitotronic is slow
+  Fixture f;
+  f.device.responseDelay = 450;
+  f.engine.read(0x2000, MAX_DP_LENGTH);
+  CHECK(f.run());
+  CHECK_EQ(errors.size(), 0);
+  CHECK_EQ(received.size(), MAX_DP_LENGTH);
+  // the 750 ms bucket, but not slower than the answer
+  CHECK_EQ(f.engine.stats().rttPercentile(99), f.engine.stats().rttMax);
+  CHECK(f.engine.stats().rttMax < 750);
+
+  // too slow: timeout after the latency, reset and on with the next one
+  f.device.responseDelay = 700;
+  f.engine.read(0x2000, 1);
+  uint32_t start = f.link.millis();
+  CHECK(f.run());
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], TIMEOUT);
+  CHECK(f.link.millis() - start < 1000);
+  f.device.responseDelay = 20;
+  f.engine.read(0x2001, 1);
+  CHECK(f.run());
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(received[0], 1);
+  CHECK_EQ(f.device.resets, 2);
+}
+
+static void testErrorAnswer() {
+  Fixture f;
+  f.device.errorAddresses.insert(0x4000);
+  f.engine.read(0x4000, 2);
+  f.engine.read(0x2001, 1);
+  CHECK(f.run());
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], VITO_ERROR);
+  CHECK_EQ(received[0], 1);
+}
+
+static void testStrayAnswers() {
+  // answers to other requests, eg. late ones, are dropped whatever they
+  // carry, also errors
+  Fixture f;
+  f.engine.read(0x2000, 1);
+  CHECK(f.run());
+  f.engine.read(0x2001, 1);
+  while (f.device.reads < 2) runFor(f.link, f.engine, f.device, 1);
+  // error for 0x5525, and a read of 0x5525
+  const uint8_t stray[] = {0x41, 0x05, 0x03, 0x01, 0x55, 0x25, 0x02, 0x85,
+                           0x41, 0x07, 0x01, 0x01, 0x55, 0x25, 0x02, 0x4E, 0x00, 0xD3};
+  f.link.deviceWrite(stray, sizeof(stray));
+  CHECK(f.run());
+  CHECK_EQ(errors.size(), 0);
+  CHECK_EQ(received[0], 1);
+  CHECK_EQ(f.engine.stats().discarded, 2);
+}
+
+static void testCorruptAnswer() {
+  // a broken answer to the current request is a CRC error, not a stray
+  // answer, and it isn't acknowledged
+  Fixture f;
+  f.engine.read(0x2000, 1);
+  CHECK(f.run());
+  std::vector<uint8_t> sent;
+  uint8_t answer = 0;
+  f.link.filter = [&sent, &answer](bool toDevice, uint8_t& data) {
+    if (toDevice) {
+      sent.push_back(data);
+    } else if (data == 0x41 || answer) {
+      // low byte of the address
+      if (++answer == 6) data ^= 0x10;
+    }
+    return true;
+  };
+  f.engine.read(0x2001, 1);
+  uint32_t start = f.link.millis();
+  CHECK(f.run());
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], CRC);
+  CHECK_EQ(f.engine.stats().discarded, 0);
+  CHECK_EQ(sent.back(), 0x15);
+  // without waiting for the timeout
+  CHECK(f.link.millis() - start < 200);
+
+  f.link.filter = nullptr;
+  f.engine.read(0x2001, 1);
+  CHECK(f.run());
+  CHECK_EQ(received[0], 1);
+  CHECK_EQ(errors.size(), 1);
+}
+
+static void testNack() {
+  Fixture f;
+  // break the checksum of the first request frame
+  bool corrupted = false;
+  uint8_t position = 0;
+  f.link.filter = [&](bool toDevice, uint8_t& data) {
+    if (!toDevice || corrupted) return true;
+    if (data == 0x41 && position == 0) position = 1;
+    if (position > 0 && ++position == 9) {
+      data ^= 0xFF;
+      corrupted = true;
+    }
+    return true;
+  };
+  f.engine.read(0x2000, 1);
+  f.engine.read(0x2001, 1);
+  CHECK(f.run());
+  CHECK_EQ(f.device.nacks, 1);
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], NACK);
+  CHECK_EQ(received[0], 1);
+}
+
+static void testSilentDevice() {
+  // a request without any answer is failed by the watchdog
+  Fixture f;
+  f.device.silent = true;
+  f.engine.read(0x2000, 1);
+  runFor(f.link, f.engine, f.device, 4900);
+  CHECK_EQ(errors.size(), 0);
+  CHECK(f.run(200));
+  CHECK_EQ(errors.size(), 1);
+  CHECK_EQ(errors[0], TIMEOUT);
+}
+
+static void testKeepalive() {
+  Fixture f;
+  f.engine.read(0x2000, 1);
+  CHECK(f.run());
+  uint32_t inits = f.device.inits;
+  runFor(f.link, f.engine, f.device, 12000);
+  CHECK_EQ(f.device.inits, inits + 2);
+  CHECK(f.device.connected());
+}
+
+int main() {
+  testReadWrite();
+  testLongRead();
+  testWriteCoalescing();
+  testResponseLatency();
+  testErrorAnswer();
+  testStrayAnswers();
+  testCorruptAnswer();
+  testNack();
+  testSilentDevice();
+  testKeepalive();
+  return testResult();
+}
@@ -0,0 +1,211 @@
+/*
+  test_replay.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "esphome/core/log.h"
+#include "capture_replay.h"
+#include "sim_gwg.h"
+#include "sim_kw.h"
+#include "sim_p300.h"
+#include "vitoconnect_optolinkGWG.h"
+#include "vitoconnect_optolinkKW.h"
+#include "vitoconnect_optolinkP300.h"
+#include "vitoconnect_transportCapture.h"
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+#ifndef CAPTURE_DIR
+#define CAPTURE_DIR "captures"
+#endif
+
+static std::vector<std::string> logLines;
+static uint32_t warnings = 0;
+
+static void logSink(int level, const char* tag, const char* message) {
+  if (level == ESPHOME_LOG_LEVEL_WARN) {
+    ++warnings;
+  } else if (strncmp(message, "capture ", 8) == 0) {
+    logLines.push_back(message);
+  }
+}
+
+static void onData(uint8_t* data, uint8_t len, void* arg) {}
+static void onError(uint8_t error, void* arg) {}
+
+static uint8_t value(uint16_t address) { return (address * 13 + 5) & 0xFF; }
+
+// Record a session of reads and a write with a simulated Vitotronic
+static std::vector<CaptureLine> record(ReplayProtocol protocol, uint16_t base, size_t bufferLines) {
+  HostLink link;
+  CaptureTransport capture(&link, &link);
+  capture.resize(bufferLines);
+  std::unique_ptr<SimulatedDevice> device;
+  std::unique_ptr<Optolink> engine;
+  switch (protocol) {
+  case REPLAY_P300: {
+    SimP300* sim = new SimP300(&link);
+    for (uint32_t i = 0; i < 0x10000; ++i) sim->memory[i] = value(i);
+    device.reset(sim);
+    engine.reset(new OptolinkP300(&capture, &link));
+    break;
+  }
+  case REPLAY_KW: {
+    SimKW* sim = new SimKW(&link);
+    for (uint32_t i = 0; i < 0x10000; ++i) sim->memory[i] = value(i);
+    device.reset(sim);
+    engine.reset(new OptolinkKW(&capture, &link));
+    break;
+  }
+  default: {
+    SimGWG* sim = new SimGWG(&link);
+    for (int i = 0; i < 0x100; ++i) sim->memory[GWG_PHYSICAL][i] = value(base | i);
+    device.reset(sim);
+    engine.reset(new OptolinkGWG(&capture, &link));
+    break;
+  }
+  }
+  engine->onData(onData);
+  engine->onError(onError);
+  engine->begin();
+
+  logLines.clear();
+  esphome::host_log_sink(logSink);
+  const OptolinkStats& stats = engine->stats();
+  auto run = [&](uint32_t ms) {
+    for (uint32_t i = 0; i < ms; ++i) {
+      uint32_t finished = stats.transactions + stats.errorCount();
+      link.advance(1);
+      device->loop();
+      engine->loop();
+      capture.poll(engine->queueSize() == 0 || stats.transactions + stats.errorCount() != finished);
+    }
+  };
+  // two update intervals with a long read, then a write
+  for (int update = 0; update < 2; ++update) {
+    for (uint16_t i = 0; i < 4; ++i) engine->read(base + i * 0x10, 2);
+    engine->read(base + 0x40, 12);
+    run(3000);
+  }
+  uint8_t written[] = {0x12, 0x34};
+  // GWG selects the function by the address' MSB
+  engine->write(protocol == REPLAY_GWG ? 0x0480 : base + 0x80, 2, written);
+  run(3000);
+  esphome::host_log_sink(nullptr);
+
+  std::vector<CaptureLine> lines;
+  CaptureLine line;
+  for (const std::string& text : logLines) {
+    CHECK(parseCaptureLine(text, &line));
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+static void testParse() {
+  CaptureLine line;
+  CHECK(parseCaptureLine("[12:00:01][I][vitoconnect:61]: capture 120441 RX 06 41 07 4E 00 15\033[0m", &line));
+  CHECK_EQ(line.millis, 120441);
+  CHECK(!line.tx);
+  CHECK_EQ(line.data.size(), 6);
+  CHECK_EQ(line.data[5], 0x15);
+  CHECK(parseCaptureLine("capture 7 TX 04", &line));
+  CHECK(line.tx);
+  CHECK(!parseCaptureLine("[I][vitoconnect:61]: capture buffer full, 3 lines dropped", &line));
+  CHECK(!parseCaptureLine("Schedule sensor update", &line));
+
+  std::vector<uint8_t> p300 = {0x06, 0x41, 0x07, 0x00, 0x02, 0x20, 0x80, 0x02, 0x12, 0x34, 0x00};
+  std::vector<ReplayRequest> requests = parseRequests(REPLAY_P300, p300);
+  CHECK_EQ(requests.size(), 1);
+  CHECK(requests[0].write);
+  CHECK_EQ(requests[0].address, 0x2080);
+  CHECK_EQ(requests[0].value[1], 0x34);
+
+  std::vector<uint8_t> gwg = {0x01, 0xCB, 0x10, 0x02, 0x04};
+  requests = parseRequests(REPLAY_GWG, gwg);
+  CHECK_EQ(requests.size(), 1);
+  CHECK_EQ(requests[0].address, 0x0310);
+}
+
+static void testRoundTrip(ReplayProtocol protocol, uint16_t base) {
+  std::vector<CaptureLine> capture = record(protocol, base, 64);
+  CHECK(capture.size() > 10);
+
+  ReplayResult result = replay(protocol, capture);
+  CHECK(result.complete);
+  CHECK_EQ(result.mismatches, 0);
+  // 2 x 5 reads, the long one in 2 chunks, and the write
+  CHECK_EQ(result.values.size(), 2 * 6 + 1);
+  for (const ReplayValue& replayed : result.values) {
+    CHECK(!replayed.error);
+    if (replayed.write) continue;
+    for (size_t i = 0; i < replayed.data.size(); ++i) CHECK_EQ(replayed.data[i], value(replayed.address + i));
+  }
+  CHECK(result.values.back().write);
+  CHECK_EQ(result.values.back().data[1], 0x34);
+}
+
+static void testBufferFull() {
+  warnings = 0;
+  std::vector<CaptureLine> capture = record(REPLAY_P300, 0x2000, 2);
+  // logged between transactions, at most 2 lines each time
+  CHECK(capture.size() > 10);
+  CHECK(warnings > 0);
+}
+
+static void testSample() {
+  // log of a session from boot: two reads and a write
+  FILE* file = fopen(CAPTURE_DIR "/p300.log", "r");
+  CHECK(file != nullptr);
+  if (!file) return;
+  std::vector<CaptureLine> capture = readCapture(file);
+  fclose(file);
+
+  ReplayResult result = replay(REPLAY_P300, capture);
+  CHECK(result.complete);
+  CHECK_EQ(result.mismatches, 0);
+  CHECK_EQ(result.values.size(), 3);
+  if (result.values.size() != 3) return;
+  // outside temperature 7.8 °C
+  CHECK_EQ(result.values[0].address, 0x5525);
+  CHECK_EQ(result.values[0].data[0], 0x4E);
+  CHECK_EQ(result.values[0].data[1], 0x00);
+  // boiler temperature 51.2 °C
+  CHECK_EQ(result.values[1].address, 0x0810);
+  CHECK_EQ(result.values[1].data[0], 0x00);
+  CHECK_EQ(result.values[1].data[1], 0x02);
+  // operating mode set to 2
+  CHECK_EQ(result.values[2].address, 0x2323);
+  CHECK(result.values[2].write);
+  CHECK_EQ(result.values[2].data[0], 0x02);
+}
+
+int main() {
+  testParse();
+  testRoundTrip(REPLAY_P300, 0x2000);
+  testRoundTrip(REPLAY_KW, 0x2000);
+  testRoundTrip(REPLAY_GWG, 0x0300);
+  testBufferFull();
+  testSample();
+  return testResult();
+}
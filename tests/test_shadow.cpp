@@ -0,0 +1,117 @@
+/*
+  test_shadow.cpp - Connect Viessmann heating devices via Optolink to ESPhome
+
+  Copyright (C) 2023  Philipp Danner
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "vitoconnect_shadow.h"
+
+#include "test.h"
+
+using namespace esphome::vitoconnect;
+
+static void testStoreAndFetch() {
+  ShadowImage shadow;
+  uint8_t data[] = {1, 2, 3, 4};
+  uint8_t out[4] = {0};
+  uint32_t timestamp = 0;
+
+  CHECK(!shadow.fetch(0x1000, 4, out, &timestamp));
+  CHECK(shadow.store(0x1000, data, 4, 100));
+  CHECK(shadow.fetch(0x1000, 4, out, &timestamp));
+  CHECK_EQ(out[3], 4);
+  CHECK_EQ(timestamp, 100);
+  // inner bytes, only checked
+  CHECK(shadow.fetch(0x1001, 2, nullptr, &timestamp));
+  CHECK(!shadow.fetch(0x0FFF, 2, nullptr, &timestamp));
+  CHECK(!shadow.fetch(0x1003, 2, nullptr, &timestamp));
+
+  // same bytes again: not changed, but newer
+  CHECK(!shadow.store(0x1000, data, 4, 200));
+  CHECK(shadow.fetch(0x1000, 4, out, &timestamp));
+  CHECK_EQ(timestamp, 200);
+  CHECK_EQ(shadow.ranges(), 1);
+}
+
+static void testOverlaps() {
+  ShadowImage shadow;
+  uint8_t block[] = {1, 2, 3, 4, 5, 6};
+  uint8_t inner[] = {9, 9};
+  uint8_t out[6] = {0};
+  uint32_t timestamp = 0;
+
+  shadow.store(0x2000, block, 6, 100);
+  // a part of the block, stored in place without splitting it
+  CHECK(shadow.store(0x2002, inner, 2, 300));
+  CHECK_EQ(shadow.ranges(), 1);
+  CHECK_EQ(shadow.bytes(), 6);
+  CHECK(shadow.fetch(0x2000, 6, out, &timestamp));
+  CHECK_EQ(out[1], 2);
+  CHECK_EQ(out[2], 9);
+  CHECK_EQ(out[3], 9);
+  CHECK_EQ(out[4], 5);
+  // oldest byte counts
+  CHECK_EQ(timestamp, 100);
+  CHECK(shadow.fetch(0x2002, 2, out, &timestamp));
+  CHECK_EQ(timestamp, 100);
+
+  // the whole block again
+  shadow.store(0x2000, block, 6, 400);
+  CHECK_EQ(shadow.ranges(), 1);
+  CHECK(shadow.fetch(0x2000, 6, out, &timestamp));
+  CHECK_EQ(out[2], 3);
+  CHECK_EQ(timestamp, 400);
+
+  // pieces known before, overlapped partly: merged into one range
+  shadow.store(0x3001, inner, 2, 500);
+  shadow.store(0x3004, inner, 2, 600);
+  CHECK(shadow.store(0x3002, block, 3, 700));
+  CHECK_EQ(shadow.ranges(), 2);
+  CHECK(shadow.fetch(0x3001, 5, out, &timestamp));
+  CHECK_EQ(out[0], 9);
+  CHECK_EQ(out[1], 1);
+  CHECK_EQ(out[3], 3);
+  CHECK_EQ(out[4], 9);
+  CHECK_EQ(timestamp, 500);
+  // and replaced by the whole block
+  shadow.store(0x3000, block, 6, 800);
+  CHECK_EQ(shadow.ranges(), 2);
+  CHECK(shadow.fetch(0x3000, 6, out, &timestamp));
+  CHECK_EQ(out[5], 6);
+  CHECK_EQ(timestamp, 800);
+
+  // separate range, gap in between
+  shadow.store(0x2010, inner, 2, 500);
+  CHECK_EQ(shadow.ranges(), 3);
+  CHECK(!shadow.fetch(0x2004, 0x10, nullptr, &timestamp));
+}
+
+static void testTimestampWraparound() {
+  ShadowImage shadow;
+  uint8_t data[] = {1, 2};
+  uint32_t timestamp = 0;
+  shadow.store(0x3000, data, 1, 0xFFFFFFF0);
+  shadow.store(0x3001, &data[1], 1, 0x10);
+  CHECK(shadow.fetch(0x3000, 2, nullptr, &timestamp));
+  CHECK_EQ(timestamp, 0xFFFFFFF0);
+}
+
+int main() {
+  testStoreAndFetch();
+  testOverlaps();
+  testTimestampWraparound();
+  return testResult();
+}